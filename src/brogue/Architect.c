@@ -23,6 +23,7 @@
 
 #include "Rogue.h"
 #include "IncludeGlobals.h"
+#include <limits.h>
 
 short topBlobMinX, topBlobMinY, blobWidth, blobHeight;
 
@@ -33,6 +34,36 @@ boolean cellHasTerrainFlag(short x, short y, unsigned long flagMask) {
 }
 #endif
 
+#ifdef VERIFY_TERRAIN_FLAGS // otherwise handled as macros in rogue.h
+static void verifyTerrainFlags(short x, short y) {
+    if (pmap[x][y].terrainFlags != layerTerrainFlags(x, y)
+        || pmap[x][y].TMFlags != layerTerrainMechFlags(x, y)) {
+
+        fprintf(stderr, "Stale terrain flags at (%i, %i), depth %i, turn %lu\n",
+                x, y, rogue.depthLevel, rogue.absoluteTurnNumber);
+        abort();
+    }
+}
+
+unsigned long verifiedTerrainFlags(short x, short y) {
+    verifyTerrainFlags(x, y);
+    return pmap[x][y].terrainFlags;
+}
+
+unsigned long verifiedTerrainMechFlags(short x, short y) {
+    verifyTerrainFlags(x, y);
+    return pmap[x][y].TMFlags;
+}
+#endif
+
+// Recomputes the flags cached in the cell from its layers.
+void refreshTerrainFlags(short x, short y) {
+    pmap[x][y].terrainFlags = layerTerrainFlags(x, y);
+    pmap[x][y].TMFlags = layerTerrainMechFlags(x, y);
+    noteEnvironmentChangeAt(x, y);
+    noteTerrainChange();
+}
+
 boolean checkLoopiness(short x, short y) {
     boolean inString;
     short newX, newY, dir, sdir;
@@ -168,9 +199,247 @@ short passableArcCount(short x, short y) {
     return arcCount / 2; // Since we added one when we entered a wall and another when we left.
 }
 
+// The chokepoint map is built from one depth-first search over the passable cells, orthogonally
+// connected. With a chokepoint blocked, the open cell next to it is either in the subtree of one of
+// its children in the search tree that has no way around it, or in whatever is left of its component;
+// either way the region is a few runs of consecutive cells in search order, and its size falls out of
+// the subtree sizes. The regions are then applied to the map in order of size, smallest first and in
+// the order that the chokepoints were found among equals, each claiming only the cells that no
+// earlier region claimed.
+
+#define CHOKE_REGION_MAX_RUNS   6
+
+typedef struct chokeRegion {
+    short value;                // the size of the region that the chokepoint cuts off
+    short order;                // the order in which the chokepoint and neighbor were found
+    boolean isGate;             // whether this is the chokepoint itself rather than the region it cuts off
+    short runCount;
+    short runs[CHOKE_REGION_MAX_RUNS][2]; // [start, end) in search order
+} chokeRegion;
+
+static short chokeSearchIndex[DCOLS][DROWS];    // position in search order, or -1 if not reached
+static short chokeSearchLow[DCOLS][DROWS];      // earliest position reachable from the subtree with one back edge
+static short chokeSearchEnd[DCOLS][DROWS];      // position just past the subtree
+static short chokeSearchParent[DCOLS][DROWS];   // position of the parent, or -1 for the root
+static short chokeSearchRoot[DCOLS][DROWS];     // position of the root of the component
+static long chokeSearchWeight[DCOLS][DROWS];    // size of the subtree, counting an area machine cell as 10000
+static short chokeSearchCells[DCOLS * DROWS][2];
+static short chokeSearchCount;
+
+static void searchChokeTree(char passMap[DCOLS][DROWS], short x, short y, short parent, short root) {
+    short dir, newX, newY;
+
+    chokeSearchIndex[x][y] = chokeSearchLow[x][y] = chokeSearchCount;
+    chokeSearchParent[x][y] = parent;
+    chokeSearchRoot[x][y] = (root < 0 ? chokeSearchCount : root);
+    chokeSearchWeight[x][y] = ((pmap[x][y].flags & IS_IN_AREA_MACHINE) ? 10000 : 1);
+    chokeSearchCells[chokeSearchCount][0] = x;
+    chokeSearchCells[chokeSearchCount][1] = y;
+    chokeSearchCount++;
+
+    for (dir = 0; dir < 4; dir++) {
+        newX = x + nbDirs[dir][0];
+        newY = y + nbDirs[dir][1];
+        if (coordinatesAreInMap(newX, newY) && passMap[newX][newY]) {
+            if (chokeSearchIndex[newX][newY] < 0) {
+                searchChokeTree(passMap, newX, newY, chokeSearchIndex[x][y], chokeSearchRoot[x][y]);
+                chokeSearchLow[x][y] = min(chokeSearchLow[x][y], chokeSearchLow[newX][newY]);
+                chokeSearchWeight[x][y] += chokeSearchWeight[newX][newY];
+            } else {
+                chokeSearchLow[x][y] = min(chokeSearchLow[x][y], chokeSearchIndex[newX][newY]);
+            }
+        }
+    }
+    chokeSearchEnd[x][y] = chokeSearchCount;
+}
+
+// Describes the region that blocking the chokepoint (x, y) would cut off from its neighbor (nx, ny).
+// Returns the region's size, counting an area machine cell as 10000.
+static long chokeRegionBehind(short x, short y, short nx, short ny, chokeRegion *region) {
+    const short start = chokeSearchIndex[x][y], end = chokeSearchEnd[x][y];
+    const short neighbor = chokeSearchIndex[nx][ny];
+    short dir, childX, childY, root, rootX, rootY;
+    long weight;
+
+    region->runCount = 0;
+
+    // Is the neighbor in the subtree of a child that is cut off with it?
+    if (neighbor > start && neighbor < end) {
+        for (dir = 0; dir < 4; dir++) {
+            childX = x + nbDirs[dir][0];
+            childY = y + nbDirs[dir][1];
+            if (coordinatesAreInMap(childX, childY)
+                && chokeSearchIndex[childX][childY] >= 0
+                && chokeSearchParent[childX][childY] == start
+                && neighbor >= chokeSearchIndex[childX][childY]
+                && neighbor < chokeSearchEnd[childX][childY]
+                && chokeSearchLow[childX][childY] >= start) {
+
+                region->runs[0][0] = chokeSearchIndex[childX][childY];
+                region->runs[0][1] = chokeSearchEnd[childX][childY];
+                region->runCount = 1;
+                return chokeSearchWeight[childX][childY];
+            }
+        }
+    }
+
+    // Otherwise it is the rest of the component: everything outside the chokepoint's subtree,
+    // plus the subtrees of its children that reach around it.
+    root = chokeSearchRoot[x][y];
+    rootX = chokeSearchCells[root][0];
+    rootY = chokeSearchCells[root][1];
+    weight = chokeSearchWeight[rootX][rootY] - chokeSearchWeight[x][y];
+    region->runs[region->runCount][0] = root;
+    region->runs[region->runCount][1] = start;
+    region->runCount++;
+    region->runs[region->runCount][0] = end;
+    region->runs[region->runCount][1] = chokeSearchEnd[rootX][rootY];
+    region->runCount++;
+    for (dir = 0; dir < 4; dir++) {
+        childX = x + nbDirs[dir][0];
+        childY = y + nbDirs[dir][1];
+        if (coordinatesAreInMap(childX, childY)
+            && chokeSearchIndex[childX][childY] >= 0
+            && chokeSearchParent[childX][childY] == start
+            && chokeSearchLow[childX][childY] < start) {
+
+            weight += chokeSearchWeight[childX][childY];
+            region->runs[region->runCount][0] = chokeSearchIndex[childX][childY];
+            region->runs[region->runCount][1] = chokeSearchEnd[childX][childY];
+            region->runCount++;
+        }
+    }
+    return weight;
+}
+
+static int compareChokeRegions(const void *a, const void *b) {
+    const chokeRegion *r1 = (const chokeRegion *) a, *r2 = (const chokeRegion *) b;
+
+    if (r1->value != r2->value) {
+        return r1->value - r2->value;
+    }
+    return r1->order - r2->order;
+}
+
+// The next position in search order at or after i that no region has claimed yet.
+static short nextUnclaimedChokeCell(short unclaimed[DCOLS * DROWS + 1], short i) {
+    short root = i, next;
+
+    while (unclaimed[root] != root) {
+        root = unclaimed[root];
+    }
+    while (unclaimed[i] != root) {
+        next = unclaimed[i];
+        unclaimed[i] = root;
+        i = next;
+    }
+    return root;
+}
+
+static void fillChokeMap(char passMap[DCOLS][DROWS]) {
+    short i, j, dir, newX, newY, cellCount, order, run, position;
+    short unclaimed[DCOLS * DROWS + 1];
+    char grid[DCOLS][DROWS];
+    chokeRegion *regions;
+    long regionCount, regionCapacity, weight;
+
+    fillGrid(chokeMap, 30000);
+    for (i = 0; i < DCOLS; i++) {
+        for (j = 0; j < DROWS; j++) {
+            chokeSearchIndex[i][j] = -1;
+        }
+    }
+    chokeSearchCount = 0;
+    for (i = 0; i < DCOLS; i++) {
+        for (j = 0; j < DROWS; j++) {
+            if (passMap[i][j] && chokeSearchIndex[i][j] < 0) {
+                searchChokeTree(passMap, i, j, -1, -1);
+            }
+        }
+    }
+
+    // Each chokepoint yields up to four regions and itself once per region.
+    regionCapacity = DCOLS * DROWS;
+    regions = malloc(sizeof(chokeRegion) * regionCapacity);
+    regionCount = 0;
+    order = 0;
+    for (i = 0; i < DCOLS; i++) {
+        for (j = 0; j < DROWS; j++) {
+            if (passMap[i][j] && (pmap[i][j].flags & IS_CHOKEPOINT)) {
+                for (dir = 0; dir < 4; dir++) {
+                    newX = i + nbDirs[dir][0];
+                    newY = j + nbDirs[dir][1];
+                    if (coordinatesAreInMap(newX, newY)
+                        && passMap[newX][newY]
+                        && !(pmap[newX][newY].flags & IS_CHOKEPOINT)) {
+
+                        if (regionCount + 2 > regionCapacity) {
+                            regionCapacity *= 2;
+                            regions = realloc(regions, sizeof(chokeRegion) * regionCapacity);
+                        }
+                        weight = chokeRegionBehind(i, j, newX, newY, &regions[regionCount]);
+                        if (weight <= SHRT_MAX) {
+                            cellCount = min(weight, 10000);
+                        } else {
+                            // floodFillCount keeps its running total in a short, and a region this big can
+                            // overflow it partway through; that total depends on the order of the fill,
+                            // so the fill is run for real.
+                            zeroOutGrid(grid);
+                            passMap[i][j] = false;
+                            cellCount = floodFillCount(grid, passMap, newX, newY);
+                            passMap[i][j] = true;
+                        }
+                        // CellCounts less than 4 are not useful, so we skip those cases.
+                        if (cellCount >= 4) {
+                            regions[regionCount].value = cellCount;
+                            regions[regionCount].order = order;
+                            regions[regionCount].isGate = false;
+                            regionCount++;
+
+                            regions[regionCount].value = cellCount;
+                            regions[regionCount].order = order;
+                            regions[regionCount].isGate = true;
+                            regions[regionCount].runs[0][0] = chokeSearchIndex[i][j];
+                            regions[regionCount].runs[0][1] = chokeSearchIndex[i][j] + 1;
+                            regions[regionCount].runCount = 1;
+                            regionCount++;
+                        }
+                        order++;
+                    }
+                }
+            }
+        }
+    }
+
+    qsort(regions, regionCount, sizeof(chokeRegion), compareChokeRegions);
+
+    for (position = 0; position <= chokeSearchCount; position++) {
+        unclaimed[position] = position;
+    }
+    for (i = 0; i < regionCount; i++) {
+        for (run = 0; run < regions[i].runCount; run++) {
+            for (position = nextUnclaimedChokeCell(unclaimed, regions[i].runs[run][0]);
+                 position < regions[i].runs[run][1];
+                 position = nextUnclaimedChokeCell(unclaimed, position + 1)) {
+
+                newX = chokeSearchCells[position][0];
+                newY = chokeSearchCells[position][1];
+                chokeMap[newX][newY] = regions[i].value;
+                if (regions[i].isGate) {
+                    pmap[newX][newY].flags |= IS_GATE_SITE;
+                } else {
+                    pmap[newX][newY].flags &= ~IS_GATE_SITE;
+                }
+                unclaimed[position] = position + 1;
+            }
+        }
+    }
+    free(regions);
+}
+
 // locates all loops and chokepoints
 void analyzeMap(boolean calculateChokeMap) {
-    short i, j, i2, j2, dir, newX, newY, oldX, oldY, passableArcCount, cellCount;
+    short i, j, dir, newX, newY, oldX, oldY, passableArcCount;
     char grid[DCOLS][DROWS], passMap[DCOLS][DROWS];
     boolean designationSurvives;
 
@@ -257,62 +526,16 @@ void analyzeMap(boolean calculateChokeMap) {
         // chokepoint were blocked. If the tile is not a chokepoint, then the number indicates
         // the number of tiles that would be rendered unreachable if the nearest exit chokepoint
         // were blocked.
-        // The cost of all of this is one depth-first flood-fill per open point that is adjacent to a chokepoint.
 
-        // Start by setting the chokepoint values really high, and roping off room machines.
+        // Rope off room machines, then work out every region at once.
         for(i=0; i<DCOLS; i++) {
             for(j=0; j<DROWS; j++) {
-                chokeMap[i][j] = 30000;
                 if (pmap[i][j].flags & IS_IN_ROOM_MACHINE) {
                     passMap[i][j] = false;
                 }
             }
         }
-
-        // Scan through and find a chokepoint next to an open point.
-
-        for(i=0; i<DCOLS; i++) {
-            for(j=0; j<DROWS; j++) {
-                if (passMap[i][j] && (pmap[i][j].flags & IS_CHOKEPOINT)) {
-                    for (dir=0; dir<4; dir++) {
-                        newX = i + nbDirs[dir][0];
-                        newY = j + nbDirs[dir][1];
-                        if (coordinatesAreInMap(newX, newY)
-                            && passMap[newX][newY]
-                            && !(pmap[newX][newY].flags & IS_CHOKEPOINT)) {
-                            // OK, (newX, newY) is an open point and (i, j) is a chokepoint.
-                            // Pretend (i, j) is blocked by changing passMap, and run a flood-fill cell count starting on (newX, newY).
-                            // Keep track of the flooded region in grid[][].
-                            zeroOutGrid(grid);
-                            passMap[i][j] = false;
-                            cellCount = floodFillCount(grid, passMap, newX, newY);
-                            passMap[i][j] = true;
-
-                            // CellCount is the size of the region that would be obstructed if the chokepoint were blocked.
-                            // CellCounts less than 4 are not useful, so we skip those cases.
-
-                            if (cellCount >= 4) {
-                                // Now, on the chokemap, all of those flooded cells should take the lesser of their current value or this resultant number.
-                                for(i2=0; i2<DCOLS; i2++) {
-                                    for(j2=0; j2<DROWS; j2++) {
-                                        if (grid[i2][j2] && cellCount < chokeMap[i2][j2]) {
-                                            chokeMap[i2][j2] = cellCount;
-                                            pmap[i2][j2].flags &= ~IS_GATE_SITE;
-                                        }
-                                    }
-                                }
-
-                                // The chokepoint itself should also take the lesser of its current value or the flood count.
-                                if (cellCount < chokeMap[i][j]) {
-                                    chokeMap[i][j] = cellCount;
-                                    pmap[i][j].flags |= IS_GATE_SITE;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        fillChokeMap(passMap);
     }
 }
 
@@ -415,6 +638,7 @@ void copyMap(pcell from[DCOLS][DROWS], pcell to[DCOLS][DROWS]) {
             to[i][j] = from[i][j];
         }
     }
+    noteTerrainChange();
 }
 
 boolean itemIsADuplicate(item *theItem, item **spawnedItems, short itemCount) {
@@ -625,11 +849,13 @@ void expandMachineInterior(char interior[DCOLS][DROWS], short minimumInteriorNei
                                     pmap[i][j].layers[layer] = (layer == DUNGEON ? FLOOR : NOTHING);
                                 }
                             }
+                            refreshTerrainFlags(i, j);
                             for (dir = 0; dir < DIRECTION_COUNT; dir++) {
                                 newX = i + nbDirs[dir][0];
                                 newY = j + nbDirs[dir][1];
                                 if (pmap[newX][newY].layers[DUNGEON] == GRANITE) {
                                     pmap[newX][newY].layers[DUNGEON] = WALL;
+                                    refreshTerrainFlags(newX, newY);
                                 }
                             }
                         }
@@ -637,6 +863,7 @@ void expandMachineInterior(char interior[DCOLS][DROWS], short minimumInteriorNei
                 } else if (pmap[i][j].layers[DUNGEON] == DOOR
                            || pmap[i][j].layers[DUNGEON] == SECRET_DOOR) {
                     pmap[i][j].layers[DUNGEON] = FLOOR;
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -811,13 +1038,16 @@ void redesignInterior(char interior[DCOLS][DROWS], short originX, short originY,
             if (interior[i][j]) {
                 if (grid[i][j] >= 0) {
                     pmap[i][j].layers[SURFACE] = pmap[i][j].layers[GAS] = NOTHING;
+                    refreshTerrainFlags(i, j);
                 }
                 if (grid[i][j] == 0) {
                     pmap[i][j].layers[DUNGEON] = GRANITE;
+                    refreshTerrainFlags(i, j);
                     interior[i][j] = false;
                 }
                 if (grid[i][j] >= 1) {
                     pmap[i][j].layers[DUNGEON] = FLOOR;
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -845,6 +1075,7 @@ void prepareInteriorWithMachineFlags(char interior[DCOLS][DROWS], short originX,
                     for (layer=0; layer<NUMBER_TERRAIN_LAYERS; layer++) {
                         pmap[i][j].layers[layer] = (layer == DUNGEON ? FLOOR : NOTHING);
                     }
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -860,6 +1091,7 @@ void prepareInteriorWithMachineFlags(char interior[DCOLS][DROWS], short originX,
                             pmap[i][j].layers[layer] = (layer == DUNGEON ? FLOOR : NOTHING);
                         }
                     }
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -871,6 +1103,7 @@ void prepareInteriorWithMachineFlags(char interior[DCOLS][DROWS], short originX,
             for(j=0; j<DROWS; j++) {
                 if (interior[i][j]) {
                     pmap[i][j].layers[LIQUID] = NOTHING;
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -893,6 +1126,7 @@ void prepareInteriorWithMachineFlags(char interior[DCOLS][DROWS], short originX,
                             for (layer=0; layer<NUMBER_TERRAIN_LAYERS; layer++) {
                                 pmap[newX][newY].layers[layer] = (layer == DUNGEON ? WALL : 0);
                             }
+                            refreshTerrainFlags(newX, newY);
                         }
                     }
                 }
@@ -930,6 +1164,29 @@ void prepareInteriorWithMachineFlags(char interior[DCOLS][DROWS], short originX,
     }
 }
 
+// Copies of the level taken by buildAMachine at its point of no return, so that it can put things back if the
+// machine fails. A machine only nests inside another after that point, so they are taken and released in stack
+// order, and the space is kept between machines rather than allocated and cleared in every attempt.
+static pcell (*machineLevelBackups)[DCOLS][DROWS] = NULL;
+static short machineLevelBackupCount = 0, machineLevelBackupCapacity = 0;
+
+static short backUpLevelForMachine() {
+    if (machineLevelBackupCount == machineLevelBackupCapacity) {
+        machineLevelBackupCapacity += 4;
+        machineLevelBackups = realloc(machineLevelBackups, machineLevelBackupCapacity * sizeof(*machineLevelBackups));
+    }
+    copyMap(pmap, machineLevelBackups[machineLevelBackupCount]);
+    return machineLevelBackupCount++;
+}
+
+static void releaseMachineLevelBackup(short backup, boolean restore) {
+    brogueAssert(backup == machineLevelBackupCount - 1);
+    if (restore) {
+        copyMap(machineLevelBackups[backup], pmap);
+    }
+    machineLevelBackupCount--;
+}
+
 typedef struct machineData {
     // Our boolean grids:
     char interior[DCOLS][DROWS];    // This is the master grid for the machine. All area inside the machine are set to true.
@@ -938,7 +1195,7 @@ typedef struct machineData {
     char blockingMap[DCOLS][DROWS]; // Used during terrain/DF placement in features that are flagged not to tolerate blocking, to see if they block.
     char viewMap[DCOLS][DROWS];     // Used for features with MF_IN_VIEW_OF_ORIGIN, to calculate which cells are in view of the origin.
 
-    pcell levelBackup[DCOLS][DROWS];
+    short levelBackup;              // Which of the machineLevelBackups holds the level as it was before the machine.
 
     item *spawnedItems[MACHINES_BUFFER_LENGTH];
     item *spawnedItemsSub[MACHINES_BUFFER_LENGTH];
@@ -1186,7 +1443,7 @@ boolean buildAMachine(enum machineTypes bp,
     } while (tryAgain);
 
     // This is the point of no return. Back up the level so it can be restored if we have to abort this machine after this point.
-    copyMap(pmap, p->levelBackup);
+    p->levelBackup = backUpLevelForMachine();
 
     // Perform any transformations to the interior indicated by the blueprint flags, including expanding the interior if requested.
     prepareInteriorWithMachineFlags(p->interior, originX, originY, blueprintCatalog[bp].flags, blueprintCatalog[bp].dungeonProfileType);
@@ -1201,6 +1458,7 @@ boolean buildAMachine(enum machineTypes bp,
                 // also clear any secret doors, since they screw up distance mapping and aren't fun inside machines
                 if (pmap[i][j].layers[DUNGEON] == SECRET_DOOR) {
                     pmap[i][j].layers[DUNGEON] = DOOR;
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -1412,6 +1670,7 @@ boolean buildAMachine(enum machineTypes bp,
                     }
                     if (terrainSucceeded) {
                         pmap[featX][featY].layers[feature->layer] = feature->terrain;
+                        refreshTerrainFlags(featX, featY);
                     }
                 }
 
@@ -1533,7 +1792,7 @@ boolean buildAMachine(enum machineTypes bp,
                         if (!i) {
                             if (D_MESSAGE_MACHINE_GENERATION) printf("\nDepth %i: Failed to place blueprint %i because it requires an adoptive machine and we couldn't place one.", rogue.depthLevel, bp);
                             // failure! abort!
-                            copyMap(p->levelBackup, pmap);
+                            releaseMachineLevelBackup(p->levelBackup, true);
                             abortItemsAndMonsters(p->spawnedItems, p->spawnedMonsters);
                             freeGrid(distanceMap);
                             free(p);
@@ -1640,7 +1899,7 @@ boolean buildAMachine(enum machineTypes bp,
                          rogue.depthLevel, bp, feat, feature->minimumInstanceCount, instance);
 
             // Restore the map to how it was before we touched it.
-            copyMap(p->levelBackup, pmap);
+            releaseMachineLevelBackup(p->levelBackup, true);
             abortItemsAndMonsters(p->spawnedItems, p->spawnedMonsters);
             freeGrid(distanceMap);
             free(p);
@@ -1685,6 +1944,7 @@ boolean buildAMachine(enum machineTypes bp,
         }
     }
 
+    releaseMachineLevelBackup(p->levelBackup, false);
     free(p);
     return true;
 }
@@ -1784,6 +2044,7 @@ void runAutogenerators(boolean buildAreaMachines) {
 
                             // Build!
                             pmap[x][y].layers[gen->layer] = gen->terrain;
+                            refreshTerrainFlags(x, y);
 
                             if (D_INSPECT_LEVELGEN) {
                                 dumpLevelToScreen();
@@ -1854,6 +2115,7 @@ void cleanUpLakeBoundaries() {
                         for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
                             pmap[i][j].layers[layer] = pmap[x][y].layers[layer];
                         }
+                        refreshTerrainFlags(i, j);
                         //pmap[i][j].layers[DUNGEON] = CRYSTAL_WALL;
                     }
                 }
@@ -1892,6 +2154,7 @@ void removeDiagonalOpenings() {
                             for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
                                 pmap[x1][y1].layers[layer] = pmap[x2][y1].layers[layer];
                             }
+                            refreshTerrainFlags(x1, y1);
                         }
                     }
                 }
@@ -2447,6 +2710,7 @@ void finishWalls(boolean includingDiagonals) {
                         && (!cellHasTerrainFlag(x1, y1, T_OBSTRUCTS_VISION) || !cellHasTerrainFlag(x1, y1, T_OBSTRUCTS_PASSABILITY))) {
 
                         pmap[i][j].layers[DUNGEON] = WALL;
+                        refreshTerrainFlags(i, j);
                         foundExposure = true;
                     }
                 }
@@ -2463,6 +2727,7 @@ void finishWalls(boolean includingDiagonals) {
                 }
                 if (foundExposure == false) {
                     pmap[i][j].layers[DUNGEON] = GRANITE;
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -2513,6 +2778,7 @@ void fillLake(short x, short y, short liquid, short scanWidth, char wreathMap[DC
             if (coordinatesAreInMap(i, j) && unfilledLakeMap[i][j]) {
                 unfilledLakeMap[i][j] = false;
                 pmap[i][j].layers[LIQUID] = liquid;
+                refreshTerrainFlags(i, j);
                 wreathMap[i][j] = 1;
                 fillLake(i, j, liquid, scanWidth, wreathMap, unfilledLakeMap);  // recursive
             }
@@ -2624,6 +2890,7 @@ void designLakes(short **lakeMap) {
                         if (grid[i + lakeX][j + lakeY]) {
                             lakeMap[i + lakeX + x][j + lakeY + y] = true;
                             pmap[i + lakeX + x][j + lakeY + y].layers[DUNGEON] = FLOOR;
+                            refreshTerrainFlags(i + lakeX + x, j + lakeY + y);
                         }
                     }
                 }
@@ -2650,8 +2917,10 @@ void createWreath(short shallowLiquid, short wreathWidth, char wreathMap[DCOLS][
                         if (coordinatesAreInMap(k, l) && pmap[k][l].layers[LIQUID] == NOTHING
                             && (i-k)*(i-k) + (j-l)*(j-l) <= wreathWidth*wreathWidth) {
                             pmap[k][l].layers[LIQUID] = shallowLiquid;
+                            refreshTerrainFlags(k, l);
                             if (pmap[k][l].layers[DUNGEON] == DOOR) {
                                 pmap[k][l].layers[DUNGEON] = FLOOR;
+                                refreshTerrainFlags(k, l);
                             }
                         }
                     }
@@ -2696,6 +2965,7 @@ void finishDoors() {
                     // If there's passable terrain to the left or right, and there's passable terrain
                     // above or below, then the door is orphaned and must be removed.
                     pmap[i][j].layers[DUNGEON] = FLOOR;
+                    refreshTerrainFlags(i, j);
                 } else if ((cellHasTerrainFlag(i+1, j, T_PATHING_BLOCKER) ? 1 : 0)
                            + (cellHasTerrainFlag(i-1, j, T_PATHING_BLOCKER) ? 1 : 0)
                            + (cellHasTerrainFlag(i, j+1, T_PATHING_BLOCKER) ? 1 : 0)
@@ -2703,8 +2973,10 @@ void finishDoors() {
                     // If the door has three or more pathing blocker neighbors in the four cardinal directions,
                     // then the door is orphaned and must be removed.
                     pmap[i][j].layers[DUNGEON] = FLOOR;
+                    refreshTerrainFlags(i, j);
                 } else if (rand_percent(secretDoorChance)) {
                     pmap[i][j].layers[DUNGEON] = SECRET_DOOR;
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -2720,15 +2992,16 @@ void clearLevel() {
             pmap[i][j].layers[LIQUID] = NOTHING;
             pmap[i][j].layers[GAS] = NOTHING;
             pmap[i][j].layers[SURFACE] = NOTHING;
+            refreshTerrainFlags(i, j);
             pmap[i][j].machineNumber = 0;
-            pmap[i][j].rememberedTerrain = NOTHING;
-            pmap[i][j].rememberedTerrainFlags = (T_OBSTRUCTS_EVERYTHING);
-            pmap[i][j].rememberedTMFlags = 0;
-            pmap[i][j].rememberedCellFlags = 0;
-            pmap[i][j].rememberedItemCategory = 0;
-            pmap[i][j].rememberedItemKind = 0;
-            pmap[i][j].rememberedItemQuantity = 0;
-            pmap[i][j].rememberedItemOriginDepth = 0;
+            rmap[i][j].rememberedTerrain = NOTHING;
+            rmap[i][j].rememberedTerrainFlags = (T_OBSTRUCTS_EVERYTHING);
+            rmap[i][j].rememberedTMFlags = 0;
+            rmap[i][j].rememberedCellFlags = 0;
+            rmap[i][j].rememberedItemCategory = 0;
+            rmap[i][j].rememberedItemKind = 0;
+            rmap[i][j].rememberedItemQuantity = 0;
+            rmap[i][j].rememberedItemOriginDepth = 0;
             pmap[i][j].flags = 0;
             pmap[i][j].volume = 0;
         }
@@ -2783,9 +3056,12 @@ boolean buildABridge() {
 
                     for (l=i+1; l < k; l++) {
                         pmap[l][j].layers[LIQUID] = BRIDGE;
+                        refreshTerrainFlags(l, j);
                     }
                     pmap[i][j].layers[SURFACE] = BRIDGE_EDGE;
+                    refreshTerrainFlags(i, j);
                     pmap[k][j].layers[SURFACE] = BRIDGE_EDGE;
+                    refreshTerrainFlags(k, j);
                     return true;
                 }
 
@@ -2815,9 +3091,12 @@ boolean buildABridge() {
 
                     for (l=j+1; l < k; l++) {
                         pmap[i][l].layers[LIQUID] = BRIDGE;
+                        refreshTerrainFlags(i, l);
                     }
                     pmap[i][j].layers[SURFACE] = BRIDGE_EDGE;
+                    refreshTerrainFlags(i, j);
                     pmap[i][k].layers[SURFACE] = BRIDGE_EDGE;
+                    refreshTerrainFlags(i, k);
                     return true;
                 }
             }
@@ -2853,8 +3132,10 @@ void digDungeon() {
         for (j=0; j<DROWS; j++) {
             if (grid[i][j] == 1) {
                 pmap[i][j].layers[DUNGEON] = FLOOR;
+                refreshTerrainFlags(i, j);
             } else if (grid[i][j] == 2) {
                 pmap[i][j].layers[DUNGEON] = (rand_percent(60) && rogue.depthLevel < DEEPEST_LEVEL ? DOOR : FLOOR);
+                refreshTerrainFlags(i, j);
             }
         }
     }
@@ -2962,6 +3243,24 @@ void updateMapToShore() {
     freeGrid(costMap);
 }
 
+// The cost maps that each waypoint's distance map was last scanned with, and the source it was
+// scanned from, so that refreshing it only has to repair the distances around what has changed
+// since. NULL if not known.
+static short **waypointCostMaps[MAX_WAYPOINT_COUNT];
+static short waypointSources[MAX_WAYPOINT_COUNT][2];
+
+void forgetWaypointCosts() {
+    short i;
+
+    for (i = 0; i < MAX_WAYPOINT_COUNT; i++) {
+        if (waypointCostMaps[i]) {
+            freeGrid(waypointCostMaps[i]);
+            waypointCostMaps[i] = NULL;
+        }
+    }
+    forgetDownhillSteps();
+}
+
 // Calculates the distance map for the given waypoint.
 // This is called on all waypoints during setUpWaypoints(),
 // and then one waypoint is recalculated per turn thereafter.
@@ -2978,10 +3277,25 @@ void refreshWaypoint(short wpIndex) {
             costMap[monst->xLoc][monst->yLoc] = PDS_FORBIDDEN;
         }
     }
-    fillGrid(rogue.wpDistance[wpIndex], 30000);
-    rogue.wpDistance[wpIndex][rogue.wpCoordinates[wpIndex][0]][rogue.wpCoordinates[wpIndex][1]] = 0;
-    dijkstraScan(rogue.wpDistance[wpIndex], costMap, true);
-    freeGrid(costMap);
+    // The repair assumes the source stayed put; aggravateMonsters moves the first one.
+    if (waypointCostMaps[wpIndex]
+        && waypointSources[wpIndex][0] == rogue.wpCoordinates[wpIndex][0]
+        && waypointSources[wpIndex][1] == rogue.wpCoordinates[wpIndex][1]) {
+
+        dijkstraRepair(rogue.wpDistance[wpIndex], waypointCostMaps[wpIndex], costMap, true);
+    } else {
+        fillGrid(rogue.wpDistance[wpIndex], 30000);
+        rogue.wpDistance[wpIndex][rogue.wpCoordinates[wpIndex][0]][rogue.wpCoordinates[wpIndex][1]] = 0;
+        dijkstraScan(rogue.wpDistance[wpIndex], costMap, true);
+    }
+    brogueAssert(rogue.wpDistance[wpIndex][rogue.wpCoordinates[wpIndex][0]][rogue.wpCoordinates[wpIndex][1]] == 0);
+    if (waypointCostMaps[wpIndex]) {
+        freeGrid(waypointCostMaps[wpIndex]);
+    }
+    waypointCostMaps[wpIndex] = costMap;
+    waypointSources[wpIndex][0] = rogue.wpCoordinates[wpIndex][0];
+    waypointSources[wpIndex][1] = rogue.wpCoordinates[wpIndex][1];
+    shareDownhillSteps(rogue.wpDistance[wpIndex]);
 }
 
 void setUpWaypoints() {
@@ -2998,6 +3312,7 @@ void setUpWaypoints() {
     }
     rogue.wpCount = 0;
     rogue.wpRefreshTicker = 0;
+    forgetWaypointCosts();
     fillSequentialList(sCoord, DCOLS*DROWS);
     shuffleList(sCoord, DCOLS*DROWS);
     for (i = 0; i < DCOLS*DROWS && rogue.wpCount < MAX_WAYPOINT_COUNT; i++) {
@@ -3083,6 +3398,175 @@ short connectCell(short x, short y, short zoneLabel, char blockingMap[DCOLS][DRO
     return size;
 }
 
+static short findSplitRoot(short parent[], short n) {
+    while (parent[n] != n) {
+        parent[n] = parent[parent[n]];
+        n = parent[n];
+    }
+    return n;
+}
+
+// Answers levelIsDisconnectedWithBlockingMap(blockingMap, false) without labelling the whole level.
+// The blocking map disconnects the level exactly when the passable cells bordering the passable part of it
+// fall into more pieces once it blocks than there are passable regions among them. A search grows from each
+// of those bordering cells at once, in one breadth-first queue; searches that meet are in the same piece.
+// Pieces that border the same blocked cells are in the same region, and so are pieces that meet. The
+// difference between the number of pieces and the number of regions only shrinks as the searches meet, so
+// the usual answer, that nothing is cut off, comes as soon as it reaches zero, after a search of the
+// neighbourhood of the blocking map. A piece that runs out of cells while its region still holds another
+// piece proves the opposite, after a search of that piece.
+static boolean blockingMapSplitsLevel(char blockingMap[DCOLS][DROWS]) {
+    static short searchLabel[DCOLS][DROWS];
+    static char blockedVisited[DCOLS][DROWS];
+    static short queueX[DCOLS * DROWS], queueY[DCOLS * DROWS];
+    static short pieceParent[DCOLS * DROWS + 1], regionParent[DCOLS * DROWS + 1];
+    static short openCells[DCOLS * DROWS + 1], regionPieces[DCOLS * DROWS + 1];
+    short i, j, x, y, newX, newY, dir, label, piece, otherPiece, region, otherRegion, firstRegion;
+    short seedCount, pieceCount, regionCount, head, tail, stackSize;
+
+    memset(searchLabel, 0, sizeof(searchLabel));
+    memset(blockedVisited, 0, sizeof(blockedVisited));
+
+    // Seed a search from every passable cell that borders a passable blocked cell.
+    seedCount = 0;
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            if (blockingMap[i][j] && cellIsPassableOrDoor(i, j)) {
+                for (dir=0; dir<4; dir++) {
+                    newX = i + nbDirs[dir][0];
+                    newY = j + nbDirs[dir][1];
+                    if (coordinatesAreInMap(newX, newY)
+                        && !blockingMap[newX][newY]
+                        && searchLabel[newX][newY] == 0
+                        && cellIsPassableOrDoor(newX, newY)) {
+
+                        seedCount++;
+                        searchLabel[newX][newY] = seedCount;
+                        queueX[seedCount - 1] = newX;
+                        queueY[seedCount - 1] = newY;
+                        pieceParent[seedCount] = regionParent[seedCount] = seedCount;
+                        openCells[seedCount] = regionPieces[seedCount] = 1;
+                    }
+                }
+            }
+        }
+    }
+    pieceCount = regionCount = seedCount;
+
+    // Seeds that border one stretch of passable blocked cells are in the same region. The queue
+    // doubles as the stack for this, above the seeds.
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            if (blockingMap[i][j] && !blockedVisited[i][j] && cellIsPassableOrDoor(i, j)) {
+                firstRegion = 0;
+                blockedVisited[i][j] = true;
+                queueX[seedCount] = i;
+                queueY[seedCount] = j;
+                stackSize = 1;
+                while (stackSize > 0) {
+                    stackSize--;
+                    x = queueX[seedCount + stackSize];
+                    y = queueY[seedCount + stackSize];
+                    for (dir=0; dir<4; dir++) {
+                        newX = x + nbDirs[dir][0];
+                        newY = y + nbDirs[dir][1];
+                        if (!coordinatesAreInMap(newX, newY)) {
+                            continue;
+                        }
+                        if (searchLabel[newX][newY]) {
+                            region = findSplitRoot(regionParent, searchLabel[newX][newY]);
+                            if (!firstRegion) {
+                                firstRegion = region;
+                            } else if (region != firstRegion) {
+                                regionParent[region] = firstRegion;
+                                regionPieces[firstRegion] += regionPieces[region];
+                                regionCount--;
+                            }
+                        } else if (blockingMap[newX][newY]
+                                   && !blockedVisited[newX][newY]
+                                   && cellIsPassableOrDoor(newX, newY)) {
+                            blockedVisited[newX][newY] = true;
+                            queueX[seedCount + stackSize] = newX;
+                            queueY[seedCount + stackSize] = newY;
+                            stackSize++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (pieceCount == regionCount) {
+        return false;
+    }
+
+    head = 0;
+    tail = seedCount;
+    while (head < tail) {
+        x = queueX[head];
+        y = queueY[head];
+        head++;
+        label = searchLabel[x][y];
+        for (dir=0; dir<4; dir++) {
+            newX = x + nbDirs[dir][0];
+            newY = y + nbDirs[dir][1];
+            if (!coordinatesAreInMap(newX, newY)
+                || blockingMap[newX][newY]
+                || !cellIsPassableOrDoor(newX, newY)) {
+                continue;
+            }
+            if (searchLabel[newX][newY] == 0) {
+                searchLabel[newX][newY] = label;
+                queueX[tail] = newX;
+                queueY[tail] = newY;
+                tail++;
+                openCells[findSplitRoot(pieceParent, label)]++;
+            } else {
+                piece = findSplitRoot(pieceParent, label);
+                otherPiece = findSplitRoot(pieceParent, searchLabel[newX][newY]);
+                if (piece != otherPiece) {
+                    pieceParent[otherPiece] = piece;
+                    openCells[piece] += openCells[otherPiece];
+                    pieceCount--;
+                    region = findSplitRoot(regionParent, piece);
+                    otherRegion = findSplitRoot(regionParent, otherPiece);
+                    if (region != otherRegion) {
+                        regionParent[otherRegion] = region;
+                        regionPieces[region] += regionPieces[otherRegion] - 1;
+                        regionCount--;
+                    } else {
+                        regionPieces[region]--;
+                    }
+                    if (pieceCount == regionCount) {
+                        return false;
+                    }
+                }
+            }
+        }
+        piece = findSplitRoot(pieceParent, label);
+        if (--openCells[piece] == 0
+            && regionPieces[findSplitRoot(regionParent, piece)] > 1) {
+            return true;
+        }
+    }
+    return (pieceCount > regionCount);
+}
+
+static boolean passableCellOnMapEdge() {
+    short i;
+
+    for (i=0; i<DCOLS; i++) {
+        if (cellIsPassableOrDoor(i, 0) || cellIsPassableOrDoor(i, DROWS - 1)) {
+            return true;
+        }
+    }
+    for (i=1; i<DROWS-1; i++) {
+        if (cellIsPassableOrDoor(0, i) || cellIsPassableOrDoor(DCOLS - 1, i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Make a zone map of connected passable regions that include at least one passable
 // cell that borders the blockingMap if blockingMap blocks. Keep track of the size of each zone.
 // Then pretend that the blockingMap no longer blocks, and grow these zones into the resulting area
@@ -3093,6 +3577,11 @@ short levelIsDisconnectedWithBlockingMap(char blockingMap[DCOLS][DROWS], boolean
     char zoneMap[DCOLS][DROWS];
     short i, j, dir, zoneSizes[200], zoneCount, smallestQualifyingZoneSize, borderingZone;
 
+    // The zones below aren't seeded from the edge of the map, so leave that case to them.
+    if (!countRegionSize && !passableCellOnMapEdge()) {
+        return blockingMapSplitsLevel(blockingMap);
+    }
+
     zoneCount = 0;
     smallestQualifyingZoneSize = 10000;
     zeroOutGrid(zoneMap);
@@ -3190,6 +3679,7 @@ boolean fillSpawnMap(enum dungeonLayers layer,
                 if ((tileCatalog[surfaceTileType].flags & T_IS_FIRE)
                     && !(tileCatalog[pmap[i][j].layers[layer]].flags & T_IS_FIRE)) {
                     pmap[i][j].flags |= CAUGHT_FIRE_THIS_TURN;
+                    noteEnvironmentChangeAt(i, j);
                 }
 
                 if ((tileCatalog[pmap[i][j].layers[layer]].flags & T_PATHING_BLOCKER)
@@ -3199,6 +3689,7 @@ boolean fillSpawnMap(enum dungeonLayers layer,
                 }
 
                 pmap[i][j].layers[layer] = surfaceTileType; // Place the terrain!
+                refreshTerrainFlags(i, j);
                 accomplishedSomething = true;
 
                 if (refresh) {
@@ -3341,6 +3832,7 @@ boolean spawnDungeonFeature(short x, short y, dungeonFeature *feat, boolean refr
         if (feat->layer == GAS) {
             pmap[x][y].volume += feat->startProbability;
             pmap[x][y].layers[GAS] = feat->tile;
+            refreshTerrainFlags(x, y);
             if (refreshCell) {
                 refreshDungeonCell(x, y);
             }
@@ -3386,6 +3878,7 @@ boolean spawnDungeonFeature(short x, short y, dungeonFeature *feat, boolean refr
                             pmap[i][j].layers[layer] = (layer == DUNGEON ? FLOOR : NOTHING);
                         }
                     }
+                    refreshTerrainFlags(i, j);
                 }
             }
         }
@@ -3600,9 +4093,11 @@ void prepareForStairs(short x, short y, char grid[DCOLS][DROWS]) {
             newX = x - nbDirs[dir][1];
             newY = y - nbDirs[dir][0];
             pmap[newX][newY].layers[DUNGEON] = TORCH_WALL;
+            refreshTerrainFlags(newX, newY);
             newX = x + nbDirs[dir][1];
             newY = y + nbDirs[dir][0];
             pmap[newX][newY].layers[DUNGEON] = TORCH_WALL;
+            refreshTerrainFlags(newX, newY);
             break;
         }
     }
@@ -3612,6 +4107,7 @@ void prepareForStairs(short x, short y, char grid[DCOLS][DROWS]) {
         newY = y + nbDirs[dir][1];
         if (pmap[newX][newY].layers[DUNGEON] == GRANITE) {
             pmap[newX][newY].layers[DUNGEON] = WALL;
+            refreshTerrainFlags(newX, newY);
         }
         if (cellHasTerrainFlag(newX, newY, T_OBSTRUCTS_PASSABILITY)) {
             pmap[newX][newY].flags |= IMPREGNABLE;
@@ -3663,6 +4159,7 @@ void initializeLevel() {
     }
     pmap[downLoc[0]][downLoc[1]].layers[LIQUID]     = NOTHING;
     pmap[downLoc[0]][downLoc[1]].layers[SURFACE]    = NOTHING;
+    refreshTerrainFlags(downLoc[0], downLoc[1]);
 
     if (!levels[n+1].visited) {
         levels[n+1].upStairsLoc[0] = downLoc[0];
@@ -3689,6 +4186,7 @@ void initializeLevel() {
     }
     pmap[upLoc[0]][upLoc[1]].layers[LIQUID] = NOTHING;
     pmap[upLoc[0]][upLoc[1]].layers[SURFACE] = NOTHING;
+    refreshTerrainFlags(upLoc[0], upLoc[1]);
 
     rogue.downLoc[0] = downLoc[0];
     rogue.downLoc[1] = downLoc[1];
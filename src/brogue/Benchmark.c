@@ -0,0 +1,260 @@
+/*
+ *  Benchmark.c
+ *  Brogue
+ *
+ *  Copyright 2012. All rights reserved.
+ *
+ *  This file is part of Brogue.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include "Rogue.h"
+#include "IncludeGlobals.h"
+
+/*
+Microbenchmarks of the grid, pathing and level generation kernels, run on a
+fixed set of seeded levels so that numbers from different builds can be
+compared. Each kernel is timed separately on every level and the totals are
+reported as CPU nanoseconds per call, on stdout and optionally as JSON.
+
+The kernels run against a real game in progress, so those that change the
+level (the environment and gas updates) leave it a little different for the
+ones that follow; the order below is fixed so that this is reproducible too.
+digDungeon replaces the level altogether and so always runs last.
+*/
+
+typedef struct benchmarkLevel {
+    uint64_t seed;
+    short depth;
+} benchmarkLevel;
+
+static const benchmarkLevel benchmarkLevels[] = {
+    {1, 3},
+    {2, 9},
+    {3, 18},
+};
+
+typedef struct benchmarkKernel {
+    const char *name;
+    void (*run)();
+    long repetitions; // per level
+    long totalRepetitions;
+    double totalNanoseconds;
+} benchmarkKernel;
+
+static short **benchmarkDistanceMap, **benchmarkCostMap;
+static char benchmarkFOVGrid[DCOLS][DROWS];
+static short benchmarkCell;
+static creature *benchmarkMonster;
+
+static void benchCalculateDistances() {
+    noteTerrainChange(); // so that the map is scanned rather than copied from the cache
+    calculateDistances(benchmarkDistanceMap, player.xLoc, player.yLoc, T_PATHING_BLOCKER, NULL, true, true);
+}
+
+static void benchPathingDistance() {
+    pathingDistance(player.xLoc, player.yLoc, rogue.downLoc[0], rogue.downLoc[1], T_PATHING_BLOCKER);
+}
+
+static void benchDijkstraScan() {
+    fillGrid(benchmarkDistanceMap, 30000);
+    benchmarkDistanceMap[player.xLoc][player.yLoc] = 0;
+    dijkstraScan(benchmarkDistanceMap, benchmarkCostMap, true);
+}
+
+static void benchGetFOVMask() {
+    zeroOutGrid(benchmarkFOVGrid);
+    getFOVMask(benchmarkFOVGrid, player.xLoc, player.yLoc, DCOLS * FP_FACTOR, T_OBSTRUCTS_VISION, 0, false);
+}
+
+static void benchUpdateLighting() {
+    updateLighting();
+}
+
+// The player is buried in limbo for these two, as in startLevel, so that the fire and gas can't hurt her.
+static void benchUpdateEnvironment() {
+    short x = player.xLoc, y = player.yLoc;
+
+    player.xLoc = player.yLoc = 0;
+    updateEnvironment();
+    player.xLoc = x;
+    player.yLoc = y;
+}
+
+static void benchUpdateVolumetricMedia() {
+    short x = player.xLoc, y = player.yLoc;
+
+    player.xLoc = player.yLoc = 0;
+    updateVolumetricMedia();
+    player.xLoc = x;
+    player.yLoc = y;
+}
+
+static void benchAnalyzeMap() {
+    analyzeMap(true);
+}
+
+// One call per cell, visiting the whole map in turn.
+static void benchGetCellAppearance() {
+    enum displayGlyph theChar;
+    color foreColor, backColor;
+
+    getCellAppearance(benchmarkCell % DCOLS, benchmarkCell / DCOLS, &theChar, &foreColor, &backColor);
+    benchmarkCell = (benchmarkCell + 1) % (DCOLS * DROWS);
+}
+
+// One call per monster, each stepping toward the waypoint it is wandering to, working through the monsters in turn.
+static void benchNextStep() {
+    if (!benchmarkMonster) {
+        benchmarkMonster = monsters->nextCreature;
+    }
+    if (benchmarkMonster) {
+        nextStep(rogue.wpDistance[max(0, benchmarkMonster->targetWaypointIndex)],
+                 benchmarkMonster->xLoc, benchmarkMonster->yLoc, benchmarkMonster, false);
+        benchmarkMonster = benchmarkMonster->nextCreature;
+    }
+}
+
+// Digs the same level every time.
+static void benchDigDungeon() {
+    seedRandomGenerator(levels[rogue.depthLevel - 1].levelSeed);
+    digDungeon();
+}
+
+static benchmarkKernel benchmarkKernels[] = {
+    {"calculateDistances",      benchCalculateDistances,    3000},
+    {"pathingDistance",         benchPathingDistance,       3000},
+    {"dijkstraScan",            benchDijkstraScan,          3000},
+    {"getFOVMask",              benchGetFOVMask,            50000},
+    {"updateLighting",          benchUpdateLighting,        600},
+    {"getCellAppearance",       benchGetCellAppearance,     1000000},
+    {"nextStep",                benchNextStep,              1000000},
+    {"analyzeMap",              benchAnalyzeMap,            150},
+    {"updateVolumetricMedia",   benchUpdateVolumetricMedia, 3000},
+    {"updateEnvironment",       benchUpdateEnvironment,     1000},
+    {"digDungeon",              benchDigDungeon,            15},
+};
+
+#define NUMBER_OF_BENCHMARK_KERNELS (sizeof(benchmarkKernels) / sizeof(benchmarkKernel))
+
+static double elapsedNanoseconds(clock_t start) {
+    return (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC;
+}
+
+static void benchmarkOneLevel(const benchmarkLevel *theLevel) {
+    benchmarkKernel *kernel;
+    clock_t start;
+    long n;
+
+    rogue.nextGamePath[0] = '\0';
+    randomNumbersGenerated = 0;
+    rogue.playbackMode = false;
+    rogue.playbackFastForward = false;
+    rogue.playbackBetweenTurns = false;
+
+    initializeRogue(theLevel->seed);
+    rogue.playbackOmniscience = true;
+    for (rogue.depthLevel = 1; rogue.depthLevel <= theLevel->depth; rogue.depthLevel++) {
+        startLevel(rogue.depthLevel == 1 ? 1 : rogue.depthLevel - 1, 1);
+    }
+    rogue.depthLevel = theLevel->depth;
+
+    populateGenericCostMap(benchmarkCostMap);
+    benchmarkCell = 0;
+    benchmarkMonster = NULL;
+
+    for (kernel = benchmarkKernels; kernel < benchmarkKernels + NUMBER_OF_BENCHMARK_KERNELS; kernel++) {
+        start = clock();
+        for (n = 0; n < kernel->repetitions; n++) {
+            kernel->run();
+        }
+        kernel->totalNanoseconds += elapsedNanoseconds(start);
+        kernel->totalRepetitions += kernel->repetitions;
+    }
+
+    freeEverything();
+}
+
+static void writeBenchmarkJSON(FILE *file, double totalNanoseconds) {
+    benchmarkKernel *kernel;
+    short i;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": \"%s\",\n", BROGUE_VERSION_STRING);
+    fprintf(file, "  \"levels\": [");
+    for (i = 0; i < sizeof(benchmarkLevels) / sizeof(benchmarkLevel); i++) {
+        fprintf(file, "%s{\"seed\": %llu, \"depth\": %i}", (i ? ", " : ""),
+                (unsigned long long) benchmarkLevels[i].seed, benchmarkLevels[i].depth);
+    }
+    fprintf(file, "],\n");
+    fprintf(file, "  \"total_seconds\": %.3f,\n", totalNanoseconds / 1e9);
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (kernel = benchmarkKernels; kernel < benchmarkKernels + NUMBER_OF_BENCHMARK_KERNELS; kernel++) {
+        fprintf(file, "    {\"name\": \"%s\", \"calls\": %li, \"ns_per_op\": %.1f}%s\n",
+                kernel->name, kernel->totalRepetitions, kernel->totalNanoseconds / kernel->totalRepetitions,
+                (kernel + 1 < benchmarkKernels + NUMBER_OF_BENCHMARK_KERNELS ? "," : ""));
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+// Runs every kernel on every benchmark level, prints a table to stdout and, given a path,
+// writes the same results there as JSON. Returns false if the JSON can't be written.
+boolean runBenchmarks(const char *jsonPath) {
+    char path[BROGUE_FILENAME_MAX];
+    benchmarkKernel *kernel;
+    double totalNanoseconds = 0;
+    clock_t start;
+    FILE *file;
+    short i;
+
+    rogue.nextGame = NG_NOTHING;
+    getAvailableFilePath(path, "Benchmark", GAME_SUFFIX);
+    strcat(path, GAME_SUFFIX);
+    strcpy(currentFilePath, path);
+
+    benchmarkDistanceMap = allocGrid();
+    benchmarkCostMap = allocGrid();
+
+    start = clock();
+    for (i = 0; i < sizeof(benchmarkLevels) / sizeof(benchmarkLevel); i++) {
+        fprintf(stderr, "Benchmarking seed %llu, depth %i...\n",
+                (unsigned long long) benchmarkLevels[i].seed, benchmarkLevels[i].depth);
+        benchmarkOneLevel(&benchmarkLevels[i]);
+    }
+    totalNanoseconds = elapsedNanoseconds(start);
+    remove(currentFilePath); // Don't leave a recording of the benchmark games behind.
+
+    freeGrid(benchmarkDistanceMap);
+    freeGrid(benchmarkCostMap);
+
+    for (kernel = benchmarkKernels; kernel < benchmarkKernels + NUMBER_OF_BENCHMARK_KERNELS; kernel++) {
+        printf("%-24s %14.1f ns/op %10li calls\n",
+               kernel->name, kernel->totalNanoseconds / kernel->totalRepetitions, kernel->totalRepetitions);
+    }
+    printf("%-24s %14.3f s\n", "total", totalNanoseconds / 1e9);
+
+    if (jsonPath != NULL) {
+        file = fopen(jsonPath, "w");
+        if (file == NULL) {
+            fprintf(stderr, "Could not write %s\n", jsonPath);
+            return false;
+        }
+        writeBenchmarkJSON(file, totalNanoseconds);
+        fclose(file);
+    }
+    return true;
+}
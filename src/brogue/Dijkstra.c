@@ -26,71 +26,151 @@
 #include "Rogue.h"
 #include "IncludeGlobals.h"
 
+#define PDS_BUCKETS 17 // one for each bit of a distance, plus one for the current distance
+
 struct pdsLink {
     short distance;
     short cost;
     pdsLink *left, *right;
 };
 
+// The cells waiting to be scanned are kept in a radix heap. Bucket 0 holds the cells at the
+// last distance taken from the heap, and bucket i the cells whose distance first differs from
+// it at bit i - 1, so a cell only ever moves to lower buckets until it is scanned.
 struct pdsMap {
     boolean eightWays;
 
-    pdsLink front;
+    unsigned short last;
+    pdsLink buckets[PDS_BUCKETS];
     pdsLink links[DCOLS * DROWS];
 };
 
-void pdsUpdate(pdsMap *map) {
-    short dir, dirs;
-    pdsLink *left = NULL, *right = NULL, *link = NULL;
+// Maps distances onto keys that sort the same way when unsigned.
+static unsigned short pdsKey(short distance) {
+    return (unsigned short) distance ^ 0x8000;
+}
 
-    dirs = map->eightWays ? 8 : 4;
+// The number of bits needed to write the highest bit that differs between key and last.
+static short pdsBucket(unsigned short last, unsigned short key) {
+    static const char bitsNeeded[16] = {0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+    unsigned short difference;
+    short bucket = 0;
 
-    pdsLink *head = map->front.right;
-    map->front.right = NULL;
+    if (key <= last) {
+        return 0;
+    }
+    difference = key ^ last;
+    if (difference >= 0x100) {
+        difference >>= 8;
+        bucket += 8;
+    }
+    if (difference >= 0x10) {
+        difference >>= 4;
+        bucket += 4;
+    }
+    return bucket + bitsNeeded[difference];
+}
 
-    while (head != NULL) {
-        for (dir = 0; dir < dirs; dir++) {
-            link = head + (nbDirs[dir][0] + DCOLS * nbDirs[dir][1]);
-            if (link < map->links || link >= map->links + DCOLS * DROWS) continue;
-
-            // verify passability
-            if (link->cost < 0) continue;
-            if (dir >= 4) {
-                pdsLink *way1, *way2;
-                way1 = head + nbDirs[dir][0];
-                way2 = head + DCOLS * nbDirs[dir][1];
-                if (way1->cost == PDS_OBSTRUCTION || way2->cost == PDS_OBSTRUCTION) continue;
-            }
+static void pdsInsert(pdsMap *map, pdsLink *link) {
+    pdsLink *bucket = &map->buckets[pdsBucket(map->last, pdsKey(link->distance))];
 
-            if (head->distance + link->cost < link->distance) {
-                link->distance = head->distance + link->cost;
+    link->left = bucket;
+    link->right = bucket->right;
+    if (bucket->right != NULL) bucket->right->left = link;
+    bucket->right = link;
+}
+
+static void pdsRemove(pdsLink *link) {
+    if (link->left != NULL) {
+        link->left->right = link->right;
+        if (link->right != NULL) link->right->left = link->left;
+        link->left = NULL;
+        link->right = NULL;
+    }
+}
 
-                // reinsert the touched cell; it'll be close to the beginning of the list now, so
-                // this will be very fast.  start by removing it.
+static void pdsEmpty(pdsMap *map) {
+    short i;
 
-                if (link->right != NULL) link->right->left = link->left;
-                if (link->left != NULL) link->left->right = link->right;
+    map->last = 0;
+    for (i = 0; i < PDS_BUCKETS; i++) {
+        map->buckets[i].left = map->buckets[i].right = NULL;
+    }
+}
 
-                left = head;
-                right = head->right;
-                while (right != NULL && right->distance < link->distance) {
-                    left = right;
-                    right = right->right;
-                }
-                if (left != NULL) left->right = link;
-                link->right = right;
-                link->left = left;
-                if (right != NULL) right->left = link;
+// Removes and returns a cell with the smallest distance, or NULL if there are none.
+static pdsLink *pdsTakeNearest(pdsMap *map) {
+    pdsLink *link, *next;
+    unsigned short key;
+    short i;
+
+    if (map->buckets[0].right == NULL) {
+        for (i = 1; i < PDS_BUCKETS && map->buckets[i].right == NULL; i++);
+        if (i == PDS_BUCKETS) {
+            return NULL;
+        }
+
+        // Move up to the nearest cell in the bucket and spread the bucket over the lower ones.
+        map->last = 0xFFFF;
+        for (link = map->buckets[i].right; link != NULL; link = link->right) {
+            key = pdsKey(link->distance);
+            if (key < map->last) {
+                map->last = key;
             }
         }
+        link = map->buckets[i].right;
+        map->buckets[i].right = NULL;
+        while (link != NULL) {
+            next = link->right;
+            pdsInsert(map, link);
+            link = next;
+        }
+    }
 
-        right = head->right;
+    link = map->buckets[0].right;
+    pdsRemove(link);
+    return link;
+}
+
+// The neighbour of head in direction dir if a path can step there from head, as in pdsUpdate, or NULL.
+static pdsLink *pdsStep(pdsMap *map, pdsLink *head, short dir) {
+    pdsLink *link = head + (nbDirs[dir][0] + DCOLS * nbDirs[dir][1]);
+
+    if (link < map->links || link >= map->links + DCOLS * DROWS) return NULL;
 
-        head->left = NULL;
-        head->right = NULL;
+    // verify passability
+    if (link->cost < 0) return NULL;
+    if (dir >= 4) {
+        pdsLink *way1, *way2;
+        way1 = head + nbDirs[dir][0];
+        way2 = head + DCOLS * nbDirs[dir][1];
+        if (way1->cost == PDS_OBSTRUCTION || way2->cost == PDS_OBSTRUCTION) return NULL;
+    }
+    return link;
+}
+
+void pdsUpdate(pdsMap *map) {
+    short dir, dirs;
+    pdsLink *head, *link;
+
+    dirs = map->eightWays ? 8 : 4;
+
+    while ((head = pdsTakeNearest(map)) != NULL) {
+        for (dir = 0; dir < dirs; dir++) {
+            link = pdsStep(map, head, dir);
+            if (link == NULL) continue;
+
+            if (head->distance + link->cost < link->distance) {
+                link->distance = head->distance + link->cost;
 
-        head = right;
+                // move the touched cell to the bucket for its new distance
+                pdsRemove(link);
+                pdsInsert(map, link);
+            }
+        }
     }
+
+    map->last = 0; // so that any distance can be added before the next update
 }
 
 void pdsClear(pdsMap *map, short maxDistance, boolean eightWays) {
@@ -98,7 +178,7 @@ void pdsClear(pdsMap *map, short maxDistance, boolean eightWays) {
 
     map->eightWays = eightWays;
 
-    map->front.right = NULL;
+    pdsEmpty(map);
 
     for (i=0; i < DCOLS*DROWS; i++) {
         map->links[i].distance = maxDistance;
@@ -112,28 +192,15 @@ short pdsGetDistance(pdsMap *map, short x, short y) {
 }
 
 void pdsSetDistance(pdsMap *map, short x, short y, short distance) {
-    pdsLink *left, *right, *link;
+    pdsLink *link;
 
     if (x > 0 && y > 0 && x < DCOLS - 1 && y < DROWS - 1) {
         link = PDS_CELL(map, x, y);
         if (link->distance > distance) {
             link->distance = distance;
 
-            if (link->right != NULL) link->right->left = link->left;
-            if (link->left != NULL) link->left->right = link->right;
-
-            left = &map->front;
-            right = map->front.right;
-
-            while (right != NULL && right->distance < link->distance) {
-                left = right;
-                right = right->right;
-            }
-
-            link->right = right;
-            link->left = left;
-            left->right = link;
-            if (right != NULL) right->left = link;
+            pdsRemove(link);
+            pdsInsert(map, link);
         }
     }
 }
@@ -154,14 +221,10 @@ void pdsSetCosts(pdsMap *map, short **costMap) {
 
 void pdsBatchInput(pdsMap *map, short **distanceMap, short **costMap, short maxDistance, boolean eightWays) {
     short i, j;
-    pdsLink *left, *right;
 
     map->eightWays = eightWays;
 
-    left = NULL;
-    right = NULL;
-
-    map->front.right = NULL;
+    pdsEmpty(map);
     for (i=0; i<DCOLS; i++) {
         for (j=0; j<DROWS; j++) {
             pdsLink *link = PDS_CELL(map, i, j);
@@ -188,32 +251,8 @@ void pdsBatchInput(pdsMap *map, short **distanceMap, short **costMap, short maxD
 
             link->cost = cost;
 
-            if (cost > 0) {
-                if (link->distance < maxDistance) {
-                    if (right == NULL || right->distance > link->distance) {
-                        // left and right are used to traverse the list; if many cells have similar values,
-                        // some time can be saved by not clearing them with each insertion.  this time,
-                        // sadly, we have to start from the front.
-
-                        left = &map->front;
-                        right = map->front.right;
-                    }
-
-                    while (right != NULL && right->distance < link->distance) {
-                        left = right;
-                        right = right->right;
-                    }
-
-                    link->right = right;
-                    link->left = left;
-                    left->right = link;
-                    if (right != NULL) right->left = link;
-
-                    left = link;
-                } else {
-                    link->right = NULL;
-                    link->left = NULL;
-                }
+            if (cost > 0 && link->distance < maxDistance) {
+                pdsInsert(map, link);
             } else {
                 link->right = NULL;
                 link->left = NULL;
@@ -245,57 +284,409 @@ void dijkstraScan(short **distanceMap, short **costMap, boolean useDiagonals) {
     pdsBatchOutput(&map, distanceMap);
 }
 
+// The cost of a cell as dijkstraScan sees it: the edge of the map is always an obstruction.
+static short pdsCostAt(short **costMap, short i, short j) {
+    if (i == 0 || j == 0 || i == DCOLS - 1 || j == DROWS - 1) {
+        return PDS_OBSTRUCTION;
+    }
+    return costMap[i][j];
+}
+
+// The shortest distance to link by a step from any neighbour that has been reached, or maxDistance.
+static short pdsNearestApproach(pdsMap *map, pdsLink *link, short maxDistance) {
+    short dir, dirs, best = maxDistance;
+    pdsLink *from;
+
+    dirs = map->eightWays ? 8 : 4;
+    for (dir = 0; dir < dirs; dir++) {
+        from = link - (nbDirs[dir][0] + DCOLS * nbDirs[dir][1]);
+        if (from >= map->links && from < map->links + DCOLS * DROWS
+            && from->distance < maxDistance
+            && from->distance + link->cost < best
+            && pdsStep(map, from, dir) == link) {
+
+            best = from->distance + link->cost;
+        }
+    }
+    return best;
+}
+
+// Marks a cell whose distance has to be checked against its neighbours once the cells nearer the
+// sources have been settled.
+static void pdsQueueCheck(pdsMap *map, char checked[DCOLS * DROWS], pdsLink *link) {
+    short index = link - map->links;
+
+    if (!checked[index] && link->distance > 0 && link->distance < 30000) {
+        checked[index] = true;
+        pdsInsert(map, link);
+    }
+}
+
+// Scans a distance map again from nothing but its sources, the cells at distance zero.
+static void dijkstraRescan(short **distanceMap, short **costMap, boolean useDiagonals) {
+    short i, j;
+
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            if (distanceMap[i][j] != 0) {
+                distanceMap[i][j] = 30000;
+            }
+        }
+    }
+    dijkstraScan(distanceMap, costMap, useDiagonals);
+}
+
+// Brings a distance map made by dijkstraScan from sources at distance zero up to date after its
+// costs change from oldCostMap to costMap, with the sources staying put. The cells whose shortest
+// paths used something that got more expensive are cleared and rescanned from their neighbours,
+// and cheaper cells are rescanned from theirs, so that the rest of the map is left alone; the
+// result is what dijkstraScan would give. Maps with cells of zero cost, or whose sources changed
+// cost, are scanned again in full.
+void dijkstraRepair(short **distanceMap, short **oldCostMap, short **costMap, boolean useDiagonals) {
+    static pdsMap map;
+    static char checked[DCOLS * DROWS], rescan[DCOLS * DROWS];
+    pdsLink *link, *neighbor;
+    short i, j, dir, distance, oldCost, cost;
+    boolean scanInFull = false;
+
+    map.eightWays = useDiagonals;
+    pdsEmpty(&map);
+    memset(checked, 0, sizeof(checked));
+    memset(rescan, 0, sizeof(rescan));
+
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            link = PDS_CELL(&map, i, j);
+            link->distance = distanceMap[i][j];
+            link->cost = pdsCostAt(costMap, i, j);
+            link->left = link->right = NULL;
+
+            oldCost = pdsCostAt(oldCostMap, i, j);
+            if (link->cost == 0 || oldCost == 0
+                || link->distance == 0 && (link->cost != oldCost || link->cost < 0)) {
+
+                scanInFull = true;
+            }
+        }
+    }
+    if (scanInFull) {
+        dijkstraRescan(distanceMap, costMap, useDiagonals);
+        return;
+    }
+
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            link = PDS_CELL(&map, i, j);
+            oldCost = pdsCostAt(oldCostMap, i, j);
+            cost = link->cost;
+
+            if (oldCost >= 0 && (cost < 0 || cost > oldCost)) {
+                pdsQueueCheck(&map, checked, link);
+            } else if (cost >= 0 && (oldCost < 0 || cost < oldCost)) {
+                rescan[link - map.links] = true;
+            }
+            // a new obstruction can cut the diagonal steps around it, and a lost one open them up
+            if ((oldCost == PDS_OBSTRUCTION) != (cost == PDS_OBSTRUCTION)) {
+                for (dir = 0; dir < 8; dir++) {
+                    if (coordinatesAreInMap(i + nbDirs[dir][0], j + nbDirs[dir][1])) {
+                        neighbor = PDS_CELL(&map, i + nbDirs[dir][0], j + nbDirs[dir][1]);
+                        if (cost == PDS_OBSTRUCTION) {
+                            pdsQueueCheck(&map, checked, neighbor);
+                        } else {
+                            rescan[neighbor - map.links] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Costs are positive, so a cell's distance rests only on nearer cells, and taking the cells in order
+    // of distance means everything a cell could rest on has been checked by the time it is.
+    while ((link = pdsTakeNearest(&map)) != NULL) {
+        if (link->cost >= 0 && pdsNearestApproach(&map, link, 30000) == link->distance) {
+            continue;
+        }
+        distance = link->distance;
+        link->distance = 30000;
+        rescan[link - map.links] = true;
+        for (dir = 0; dir < 8; dir++) {
+            neighbor = link + (nbDirs[dir][0] + DCOLS * nbDirs[dir][1]);
+            if (neighbor >= map.links && neighbor < map.links + DCOLS * DROWS
+                && neighbor->distance > distance) {
+
+                pdsQueueCheck(&map, checked, neighbor);
+            }
+        }
+    }
+    map.last = 0;
+
+    for (i = 0; i < DCOLS * DROWS; i++) {
+        link = &map.links[i];
+        if (rescan[i] && link->cost > 0 && link->distance != 0) {
+            distance = pdsNearestApproach(&map, link, 30000);
+            if (distance < link->distance) {
+                link->distance = distance;
+                pdsInsert(&map, link);
+            }
+        }
+    }
+    pdsBatchOutput(&map, distanceMap);
+}
+
+#define DISTANCE_CACHE_SIZE      8
+#define MAX_CACHED_BLOCKERS     50
+
+// The distance maps calculated without a traveler depend only on the terrain and on where the
+// damage-immune stationary monsters stand, so they are kept until either changes, and asking
+// again for the same map is a copy rather than a scan.
+typedef struct cachedDistanceMap {
+    short **distanceMap; // NULL if the entry is empty
+    short destinationX, destinationY;
+    unsigned long blockingTerrainFlags;
+    boolean canUseSecretDoors, eightWays;
+    short depthLevel;
+    unsigned long terrainGeneration;
+    short blockerCount;
+    short blockers[MAX_CACHED_BLOCKERS][2];
+} cachedDistanceMap;
+
+static cachedDistanceMap distanceCache[DISTANCE_CACHE_SIZE];
+static short nextDistanceCacheEntry = 0;
+static unsigned long terrainGeneration = 0;
+
+// Called whenever the terrain of any cell changes.
+void noteTerrainChange() {
+    terrainGeneration++;
+}
+
+void forgetCachedDistances() {
+    short i;
+
+    for (i = 0; i < DISTANCE_CACHE_SIZE; i++) {
+        if (distanceCache[i].distanceMap) {
+            freeGrid(distanceCache[i].distanceMap);
+            distanceCache[i].distanceMap = NULL;
+        }
+    }
+    nextDistanceCacheEntry = 0;
+    terrainGeneration++;
+}
+
+static boolean blocksDistances(creature *monst) {
+    return ((monst->info.flags & (MONST_IMMUNE_TO_WEAPONS | MONST_INVULNERABLE))
+            && (monst->info.flags & (MONST_IMMOBILE | MONST_GETS_TURN_ON_ACTIVATION)));
+}
+
+// Lists the cells where monsterAtLoc() finds a creature that blocks distance maps, in the order of the
+// monster chain. Returns false if there are too many to list.
+static boolean listDistanceBlockers(short blockers[MAX_CACHED_BLOCKERS][2], short *blockerCount) {
+    creature *monst;
+
+    *blockerCount = 0;
+    for (monst = &player; monst != NULL; monst = (monst == &player ? monsters->nextCreature : monst->nextCreature)) {
+        if (blocksDistances(monst)
+            && coordinatesAreInMap(monst->xLoc, monst->yLoc)
+            && monsterAtLoc(monst->xLoc, monst->yLoc) == monst) {
+
+            if (*blockerCount >= MAX_CACHED_BLOCKERS) {
+                return false;
+            }
+            blockers[*blockerCount][0] = monst->xLoc;
+            blockers[*blockerCount][1] = monst->yLoc;
+            (*blockerCount)++;
+        }
+    }
+    return true;
+}
+
+static cachedDistanceMap *findCachedDistances(short destinationX, short destinationY, unsigned long blockingTerrainFlags,
+                                              boolean canUseSecretDoors, boolean eightWays,
+                                              short blockers[MAX_CACHED_BLOCKERS][2], short blockerCount) {
+    cachedDistanceMap *entry;
+
+    for (entry = distanceCache; entry < distanceCache + DISTANCE_CACHE_SIZE; entry++) {
+        if (entry->distanceMap
+            && entry->destinationX == destinationX
+            && entry->destinationY == destinationY
+            && entry->blockingTerrainFlags == blockingTerrainFlags
+            && entry->canUseSecretDoors == canUseSecretDoors
+            && entry->eightWays == eightWays
+            && entry->depthLevel == rogue.depthLevel
+            && entry->terrainGeneration == terrainGeneration
+            && entry->blockerCount == blockerCount
+            && !memcmp(entry->blockers, blockers, sizeof(short) * 2 * blockerCount)) {
+
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cacheDistances(short **distanceMap, short destinationX, short destinationY, unsigned long blockingTerrainFlags,
+                           boolean canUseSecretDoors, boolean eightWays,
+                           short blockers[MAX_CACHED_BLOCKERS][2], short blockerCount) {
+    cachedDistanceMap *entry = &distanceCache[nextDistanceCacheEntry];
+
+    nextDistanceCacheEntry = (nextDistanceCacheEntry + 1) % DISTANCE_CACHE_SIZE;
+    if (!entry->distanceMap) {
+        entry->distanceMap = allocGrid();
+    }
+    copyGrid(entry->distanceMap, distanceMap);
+    entry->destinationX = destinationX;
+    entry->destinationY = destinationY;
+    entry->blockingTerrainFlags = blockingTerrainFlags;
+    entry->canUseSecretDoors = canUseSecretDoors;
+    entry->eightWays = eightWays;
+    entry->depthLevel = rogue.depthLevel;
+    entry->terrainGeneration = terrainGeneration;
+    entry->blockerCount = blockerCount;
+    memcpy(entry->blockers, blockers, sizeof(short) * 2 * blockerCount);
+}
+
+// The cost of stepping into a cell for calculateDistances.
+static short distanceCost(short i, short j, unsigned long blockingTerrainFlags, creature *traveler, boolean canUseSecretDoors) {
+    creature *monst = monsterAtLoc(i, j);
+
+    if (monst && blocksDistances(monst)) {
+        // Always avoid damage-immune stationary monsters.
+        return PDS_FORBIDDEN;
+    } else if (canUseSecretDoors
+        && cellHasTMFlag(i, j, TM_IS_SECRET)
+        && cellHasTerrainFlag(i, j, T_OBSTRUCTS_PASSABILITY)
+        && !(discoveredTerrainFlagsAtLoc(i, j) & T_OBSTRUCTS_PASSABILITY)) {
+
+        return 1;
+    } else if (cellHasTerrainFlag(i, j, T_OBSTRUCTS_PASSABILITY)
+               || (traveler && traveler == &player && !(pmap[i][j].flags & (DISCOVERED | MAGIC_MAPPED)))) {
+
+        return cellHasTerrainFlag(i, j, T_OBSTRUCTS_DIAGONAL_MOVEMENT) ? PDS_OBSTRUCTION : PDS_FORBIDDEN;
+    } else if ((traveler && monsterAvoids(traveler, i, j)) || cellHasTerrainFlag(i, j, blockingTerrainFlags)) {
+        return PDS_FORBIDDEN;
+    } else {
+        return 1;
+    }
+}
+
 void calculateDistances(short **distanceMap,
                         short destinationX, short destinationY,
                         unsigned long blockingTerrainFlags,
                         creature *traveler,
                         boolean canUseSecretDoors,
                         boolean eightWays) {
-    creature *monst;
     static pdsMap map;
+    short blockers[MAX_CACHED_BLOCKERS][2], blockerCount = 0;
+    cachedDistanceMap *cached;
+    boolean cacheable;
 
     short i, j;
 
+    cacheable = (traveler == NULL && listDistanceBlockers(blockers, &blockerCount));
+    if (cacheable) {
+        cached = findCachedDistances(destinationX, destinationY, blockingTerrainFlags, canUseSecretDoors, eightWays,
+                                     blockers, blockerCount);
+        if (cached) {
+            copyGrid(distanceMap, cached->distanceMap);
+            return;
+        }
+    }
+
     for (i=0; i<DCOLS; i++) {
         for (j=0; j<DROWS; j++) {
-            char cost;
-            monst = monsterAtLoc(i, j);
-            if (monst
-                && (monst->info.flags & (MONST_IMMUNE_TO_WEAPONS | MONST_INVULNERABLE))
-                && (monst->info.flags & (MONST_IMMOBILE | MONST_GETS_TURN_ON_ACTIVATION))) {
-
-                // Always avoid damage-immune stationary monsters.
-                cost = PDS_FORBIDDEN;
-            } else if (canUseSecretDoors
-                && cellHasTMFlag(i, j, TM_IS_SECRET)
-                && cellHasTerrainFlag(i, j, T_OBSTRUCTS_PASSABILITY)
-                && !(discoveredTerrainFlagsAtLoc(i, j) & T_OBSTRUCTS_PASSABILITY)) {
-
-                cost = 1;
-            } else if (cellHasTerrainFlag(i, j, T_OBSTRUCTS_PASSABILITY)
-                       || (traveler && traveler == &player && !(pmap[i][j].flags & (DISCOVERED | MAGIC_MAPPED)))) {
-
-                cost = cellHasTerrainFlag(i, j, T_OBSTRUCTS_DIAGONAL_MOVEMENT) ? PDS_OBSTRUCTION : PDS_FORBIDDEN;
-            } else if ((traveler && monsterAvoids(traveler, i, j)) || cellHasTerrainFlag(i, j, blockingTerrainFlags)) {
-                cost = PDS_FORBIDDEN;
-            } else {
-                cost = 1;
-            }
-
-            PDS_CELL(&map, i, j)->cost = cost;
+            PDS_CELL(&map, i, j)->cost = distanceCost(i, j, blockingTerrainFlags, traveler, canUseSecretDoors);
         }
     }
 
     pdsClear(&map, 30000, eightWays);
     pdsSetDistance(&map, destinationX, destinationY, 0);
     pdsBatchOutput(&map, distanceMap);
+
+    if (cacheable) {
+        cacheDistances(distanceMap, destinationX, destinationY, blockingTerrainFlags, canUseSecretDoors, eightWays,
+                       blockers, blockerCount);
+    }
+}
+
+// Looks up the cost of a cell for pathingDistance the first time the search comes near it.
+static void pathingCell(pdsMap *map, char known[DCOLS * DROWS], short g[DCOLS * DROWS],
+                        short index, unsigned long blockingTerrainFlags) {
+    pdsLink *link = &map->links[index];
+
+    if (!known[index]) {
+        known[index] = true;
+        g[index] = 30000;
+        link->cost = distanceCost(index % DCOLS, index / DCOLS, blockingTerrainFlags, NULL, true);
+        link->left = link->right = NULL;
+    }
 }
 
+// The distance that calculateDistances would give from (x1, y1) to (x2, y2), found with an A* search from
+// the destination that stops on reaching (x1, y1). The steps and costs are those of the full scan, and
+// every step costs at least 1, so the number of king's moves left is a lower bound on the distance still
+// to go. It only looks at the cells that could be on a shortest path and at their neighbours.
 short pathingDistance(short x1, short y1, short x2, short y2, unsigned long blockingTerrainFlags) {
-    short retval, **distanceMap = allocGrid();
+    static pdsMap map;
+    static char known[DCOLS * DROWS];
+    static short g[DCOLS * DROWS];
+    short retval, **distanceMap;
+    short dir, x, y, index, headIndex;
+    pdsLink *head, *link;
+
+    if (x2 <= 0 || y2 <= 0 || x2 >= DCOLS - 1 || y2 >= DROWS - 1) {
+        return 30000; // calculateDistances leaves the whole map unreached
+    }
+    if (x1 == x2 && y1 == y2) {
+        return 0;
+    }
+
+    map.eightWays = true;
+    pdsEmpty(&map);
+    memset(known, 0, sizeof(known));
+
+    index = x2 + DCOLS * y2;
+    pathingCell(&map, known, g, index, blockingTerrainFlags);
+    g[index] = 0;
+    map.links[index].distance = max(abs(x1 - x2), abs(y1 - y2));
+    pdsInsert(&map, &map.links[index]);
+
+    while ((head = pdsTakeNearest(&map)) != NULL) {
+        headIndex = head - map.links;
+        x = headIndex % DCOLS;
+        y = headIndex / DCOLS;
+        if (x == x1 && y == y1) {
+            return g[headIndex];
+        }
+        if (x == 0 || x == DCOLS - 1) {
+            // Steps off the side of the map wrap around in the full scan, where the distance
+            // estimate would be wrong; this doesn't happen on any real level.
+            break;
+        }
+        for (dir = 0; dir < 8; dir++) {
+            index = headIndex + nbDirs[dir][0] + DCOLS * nbDirs[dir][1];
+            if (index >= 0 && index < DCOLS * DROWS) {
+                pathingCell(&map, known, g, index, blockingTerrainFlags);
+            }
+        }
+        for (dir = 0; dir < 8; dir++) {
+            link = pdsStep(&map, head, dir);
+            if (link == NULL) continue;
+
+            index = link - map.links;
+            if (g[headIndex] + link->cost < g[index]) {
+                g[index] = g[headIndex] + link->cost;
+                link->distance = g[index] + max(abs(x1 - index % DCOLS), abs(y1 - index / DCOLS));
+                pdsRemove(link);
+                pdsInsert(&map, link);
+            }
+        }
+    }
+
+    if (head == NULL) {
+        return 30000;
+    }
+    distanceMap = allocGrid();
     calculateDistances(distanceMap, x2, y2, blockingTerrainFlags, NULL, true, true);
     retval = distanceMap[x1][y1];
     freeGrid(distanceMap);
     return retval;
 }
-
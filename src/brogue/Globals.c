@@ -25,6 +25,7 @@
 
 tcell tmap[DCOLS][DROWS];                       // grids with info about the map
 pcell pmap[DCOLS][DROWS];
+rcell rmap[DCOLS][DROWS];                       // what the player remembers of the map
 short **scentMap;
 cellDisplayBuffer displayBuffer[COLS][ROWS];    // used to optimize plotCharWithColor
 short terrainRandomValues[DCOLS][DROWS][8];
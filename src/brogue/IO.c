@@ -1103,9 +1103,9 @@ void getCellAppearance(short x, short y, enum displayGlyph *returnChar, color *r
         && (pmap[x][y].flags & STABLE_MEMORY)) {
 
         // restore memory
-        cellChar = pmap[x][y].rememberedAppearance.character;
-        cellForeColor = colorFromComponents(pmap[x][y].rememberedAppearance.foreColorComponents);
-        cellBackColor = colorFromComponents(pmap[x][y].rememberedAppearance.backColorComponents);
+        cellChar = rmap[x][y].rememberedAppearance.character;
+        cellForeColor = colorFromComponents(rmap[x][y].rememberedAppearance.foreColorComponents);
+        cellBackColor = colorFromComponents(rmap[x][y].rememberedAppearance.backColorComponents);
     } else {
         // Find the highest-priority fore color, back color and character.
         bestFCPriority = bestBCPriority = bestCharPriority = 10000;
@@ -1255,18 +1255,18 @@ void getCellAppearance(short x, short y, enum displayGlyph *returnChar, color *r
                 cellChar = theItem->displayChar;
                 cellForeColor = *(theItem->foreColor);
                 // Remember the item was here
-                pmap[x][y].rememberedItemCategory = theItem->category;
-                pmap[x][y].rememberedItemKind = theItem->kind;
-                pmap[x][y].rememberedItemQuantity = theItem->quantity;
-                pmap[x][y].rememberedItemOriginDepth = theItem->originDepth;
+                rmap[x][y].rememberedItemCategory = theItem->category;
+                rmap[x][y].rememberedItemKind = theItem->kind;
+                rmap[x][y].rememberedItemQuantity = theItem->quantity;
+                rmap[x][y].rememberedItemOriginDepth = theItem->originDepth;
             }
         } else if (playerCanSeeOrSense(x, y) || (pmap[x][y].flags & (DISCOVERED | MAGIC_MAPPED))) {
             // just don't want these to be plotted as black
             // Also, ensure we remember there are no items here
-            pmap[x][y].rememberedItemCategory = 0;
-            pmap[x][y].rememberedItemKind = 0;
-            pmap[x][y].rememberedItemQuantity = 0;
-            pmap[x][y].rememberedItemOriginDepth = 0;
+            rmap[x][y].rememberedItemCategory = 0;
+            rmap[x][y].rememberedItemKind = 0;
+            rmap[x][y].rememberedItemQuantity = 0;
+            rmap[x][y].rememberedItemOriginDepth = 0;
         } else {
             *returnChar = ' ';
             *returnForeColor = black;
@@ -1304,15 +1304,15 @@ void getCellAppearance(short x, short y, enum displayGlyph *returnChar, color *r
             && (!monst || !monsterRevealed(monst)) && !monsterWithDetectedItem) {
 
             pmap[x][y].flags |= STABLE_MEMORY;
-            pmap[x][y].rememberedAppearance.character = cellChar;
+            rmap[x][y].rememberedAppearance.character = cellChar;
 
             if (rogue.trueColorMode) {
                 bakeTerrainColors(&cellForeColor, &cellBackColor, x, y);
             }
 
             // store memory
-            storeColorComponents(pmap[x][y].rememberedAppearance.foreColorComponents, &cellForeColor);
-            storeColorComponents(pmap[x][y].rememberedAppearance.backColorComponents, &cellBackColor);
+            storeColorComponents(rmap[x][y].rememberedAppearance.foreColorComponents, &cellForeColor);
+            storeColorComponents(rmap[x][y].rememberedAppearance.backColorComponents, &cellBackColor);
 
             applyColorAugment(&lightMultiplierColor, &basicLightColor, 100);
             if (!rogue.trueColorMode || !needDistinctness) {
@@ -1322,8 +1322,8 @@ void getCellAppearance(short x, short y, enum displayGlyph *returnChar, color *r
             bakeTerrainColors(&cellForeColor, &cellBackColor, x, y);
 
             // Then restore, so that it looks the same on this pass as it will when later refreshed.
-            cellForeColor = colorFromComponents(pmap[x][y].rememberedAppearance.foreColorComponents);
-            cellBackColor = colorFromComponents(pmap[x][y].rememberedAppearance.backColorComponents);
+            cellForeColor = colorFromComponents(rmap[x][y].rememberedAppearance.foreColorComponents);
+            cellBackColor = colorFromComponents(rmap[x][y].rememberedAppearance.backColorComponents);
         }
     }
 
@@ -1855,6 +1855,7 @@ void commitDraws() {
 void dumpLevelToScreen() {
     short i, j;
     pcell backup;
+    rcell rememberedBackup;
 
     assureCosmeticRNG;
     for (i=0; i<DCOLS; i++) {
@@ -1863,12 +1864,14 @@ void dumpLevelToScreen() {
                 || (pmap[i][j].flags & DISCOVERED)) {
 
                 backup = pmap[i][j];
+                rememberedBackup = rmap[i][j];
                 pmap[i][j].flags |= (VISIBLE | DISCOVERED);
                 tmap[i][j].light[0] = 100;
                 tmap[i][j].light[1] = 100;
                 tmap[i][j].light[2] = 100;
                 refreshDungeonCell(i, j);
                 pmap[i][j] = backup;
+                rmap[i][j] = rememberedBackup;
             } else {
                 plotCharWithColor(' ', mapToWindowX(i), mapToWindowY(j), &white, &black);
             }
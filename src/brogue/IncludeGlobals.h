@@ -23,6 +23,7 @@
 
 extern tcell tmap[DCOLS][DROWS];                        // grids with info about the map
 extern pcell pmap[DCOLS][DROWS];                        // grids with info about the map
+extern rcell rmap[DCOLS][DROWS];                        // what the player remembers of the map
 extern short **scentMap;
 extern cellDisplayBuffer displayBuffer[COLS][ROWS];
 extern short terrainRandomValues[DCOLS][DROWS][8];
@@ -44,9 +45,9 @@ extern item *packItems;
 extern item *monsterItemsHopper;
 extern short numberOfWaypoints;
 
-extern char displayedMessage[MESSAGE_LINES][COLS];
-extern boolean messageConfirmed[3];
-extern char combatText[COLS];
+extern char displayedMessage[MESSAGE_LINES][COLS*2];
+extern boolean messageConfirmed[MESSAGE_LINES];
+extern char combatText[COLS*2];
 extern short messageArchivePosition;
 extern char messageArchive[MESSAGE_ARCHIVE_LINES][COLS*2];
 
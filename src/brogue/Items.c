@@ -379,6 +379,7 @@ item *placeItem(item *theItem, short x, short y) {
         && !(pmap[x][y].flags & PRESSURE_PLATE_DEPRESSED)) {
 
         pmap[x][y].flags |= PRESSURE_PLATE_DEPRESSED;
+        noteEnvironmentChangeAt(x, y);
         if (playerCanSee(x, y)) {
             if (cellHasTMFlag(x, y, TM_IS_SECRET)) {
                 discover(x, y);
@@ -575,6 +576,7 @@ void populateItems(short upstairsX, short upstairsY) {
                 itemSpawnHeatMap[i][j] = 0;
                 pmap[i][j].layers[DUNGEON] = WALL; // due to a bug that created occasional isolated one-cell islands;
                                                    // not sure if it's still around, but this is a good-enough failsafe
+                refreshTerrainFlags(i, j);
             }
 #ifdef AUDIT_RNG
             sprintf(RNGmessage, "%u%s%s\t%s",
@@ -3477,6 +3479,7 @@ boolean tunnelize(short x, short y) {
     freeCaptivesEmbeddedAt(x, y);
     if (x == 0 || x == DCOLS - 1 || y == 0 || y == DROWS - 1) {
         pmap[x][y].layers[DUNGEON] = CRYSTAL_WALL; // don't dissolve the boundary walls
+        refreshTerrainFlags(x, y);
         didSomething = true;
     } else {
         for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
@@ -3485,6 +3488,7 @@ boolean tunnelize(short x, short y) {
                 didSomething = true;
             }
         }
+        refreshTerrainFlags(x, y);
     }
     if (didSomething) {
         spawnDungeonFeature(x, y, &dungeonFeatureCatalog[DF_TUNNELIZE], true, false);
@@ -3940,9 +3944,11 @@ void crystalize(short radius) {
 
                 if (i == 0 || i == DCOLS - 1 || j == 0 || j == DROWS - 1) {
                     pmap[i][j].layers[DUNGEON] = CRYSTAL_WALL; // don't dissolve the boundary walls
+                    refreshTerrainFlags(i, j);
                 } else if (tileCatalog[pmap[i][j].layers[DUNGEON]].flags & (T_OBSTRUCTS_PASSABILITY | T_OBSTRUCTS_VISION)) {
 
                     pmap[i][j].layers[DUNGEON] = FORCEFIELD;
+                    refreshTerrainFlags(i, j);
                     spawnDungeonFeature(i, j, &dungeonFeatureCatalog[DF_SHATTERING_SPELL], true, false);
 
                     if (pmap[i][j].flags & HAS_MONSTER) {
@@ -6470,12 +6476,12 @@ void updateIdentifiableItems() {
 
 void magicMapCell(short x, short y) {
     pmap[x][y].flags |= MAGIC_MAPPED;
-    pmap[x][y].rememberedTerrainFlags = tileCatalog[pmap[x][y].layers[DUNGEON]].flags | tileCatalog[pmap[x][y].layers[LIQUID]].flags;
-    pmap[x][y].rememberedTMFlags = tileCatalog[pmap[x][y].layers[DUNGEON]].mechFlags | tileCatalog[pmap[x][y].layers[LIQUID]].mechFlags;
+    rmap[x][y].rememberedTerrainFlags = tileCatalog[pmap[x][y].layers[DUNGEON]].flags | tileCatalog[pmap[x][y].layers[LIQUID]].flags;
+    rmap[x][y].rememberedTMFlags = tileCatalog[pmap[x][y].layers[DUNGEON]].mechFlags | tileCatalog[pmap[x][y].layers[LIQUID]].mechFlags;
     if (pmap[x][y].layers[LIQUID] && tileCatalog[pmap[x][y].layers[LIQUID]].drawPriority < tileCatalog[pmap[x][y].layers[DUNGEON]].drawPriority) {
-        pmap[x][y].rememberedTerrain = pmap[x][y].layers[LIQUID];
+        rmap[x][y].rememberedTerrain = pmap[x][y].layers[LIQUID];
     } else {
-        pmap[x][y].rememberedTerrain = pmap[x][y].layers[DUNGEON];
+        rmap[x][y].rememberedTerrain = pmap[x][y].layers[DUNGEON];
     }
 }
 
@@ -7135,13 +7141,36 @@ item *itemOfPackLetter(char letter) {
     return NULL;
 }
 
+// The floor item last seen at each location; see monstersByLocation in Monsters.c.
+static item *itemsByLocation[DCOLS][DROWS];
+
+void forgetItemLocations() {
+    memset(itemsByLocation, 0, sizeof(itemsByLocation));
+}
+
+static void forgetItemLocation(item *theItem) {
+    short i, j;
+
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            if (itemsByLocation[i][j] == theItem) {
+                itemsByLocation[i][j] = NULL;
+            }
+        }
+    }
+}
+
 item *itemAtLoc(short x, short y) {
     item *theItem;
 
     if (!(pmap[x][y].flags & HAS_ITEM)) {
         return NULL; // easy optimization
     }
-    for (theItem = floorItems->nextItem; theItem != NULL && (theItem->xLoc != x || theItem->yLoc != y); theItem = theItem->nextItem);
+    theItem = itemsByLocation[x][y];
+    if (theItem == NULL || theItem->xLoc != x || theItem->yLoc != y) {
+        for (theItem = floorItems->nextItem; theItem != NULL && (theItem->xLoc != x || theItem->yLoc != y); theItem = theItem->nextItem);
+        itemsByLocation[x][y] = theItem;
+    }
     if (theItem == NULL) {
         pmap[x][y].flags &= ~HAS_ITEM;
         hiliteCell(x, y, &white, 75, true);
@@ -7375,6 +7404,9 @@ boolean removeItemFromChain(item *theItem, item *theChain) {
          previousItem = previousItem->nextItem) {
         if (previousItem->nextItem == theItem) {
             previousItem->nextItem = theItem->nextItem;
+            if (theChain == floorItems) {
+                forgetItemLocation(theItem);
+            }
             return true;
         }
     }
@@ -7384,6 +7416,9 @@ boolean removeItemFromChain(item *theItem, item *theChain) {
 void addItemToChain(item *theItem, item *theChain) {
     theItem->nextItem = theChain->nextItem;
     theChain->nextItem = theItem;
+    if (theChain == floorItems && coordinatesAreInMap(theItem->xLoc, theItem->yLoc)) {
+        itemsByLocation[theItem->xLoc][theItem->yLoc] = theItem;
+    }
 }
 
 void deleteItem(item *theItem) {
@@ -50,10 +50,46 @@ void logLights() {
     printf("\n");
 }
 
+// Rolls the radius and color of one painting of theLight. Every painting of a light rolls them,
+// cached or not, so that the same random numbers are drawn either way.
+static fixpt rollLight(lightSource *theLight, short colorComponents[3]) {
+    fixpt radius;
+    short randComponent;
+
+    radius = randClump(theLight->lightRadius) * FP_FACTOR / 100;
+
+    randComponent = rand_range(0, theLight->lightColor->rand);
+    colorComponents[0] = randComponent + theLight->lightColor->red + rand_range(0, theLight->lightColor->redRand);
+    colorComponents[1] = randComponent + theLight->lightColor->green + rand_range(0, theLight->lightColor->greenRand);
+    colorComponents[2] = randComponent + theLight->lightColor->blue + rand_range(0, theLight->lightColor->blueRand);
+    return radius;
+}
+
+// fp_sqrt of every squared distance between two cells of the map, filled in on first use.
+#define LIGHT_DISTANCE_COUNT    ((DCOLS - 1) * (DCOLS - 1) + (DROWS - 1) * (DROWS - 1) + 1)
+static fixpt lightDistances[LIGHT_DISTANCE_COUNT];
+static boolean lightDistancesKnown = false;
+
+static short lightMultiplierAt(short dx, short dy, fixpt radius, short fadeToPercent) {
+    const int distanceSquared = dx * dx + dy * dy;
+    int i;
+
+    if (distanceSquared >= LIGHT_DISTANCE_COUNT) {
+        return 100 - (100 - fadeToPercent) * fp_sqrt(distanceSquared * FP_FACTOR) / radius;
+    }
+    if (!lightDistancesKnown) {
+        for (i = 0; i < LIGHT_DISTANCE_COUNT; i++) {
+            lightDistances[i] = fp_sqrt(i * FP_FACTOR);
+        }
+        lightDistancesKnown = true;
+    }
+    return 100 - (100 - fadeToPercent) * lightDistances[distanceSquared] / radius;
+}
+
 // Returns true if any part of the light hit cells that are in the player's field of view.
 boolean paintLight(lightSource *theLight, short x, short y, boolean isMinersLight, boolean maintainShadows) {
     short i, j, k;
-    short colorComponents[3], randComponent, lightMultiplier;
+    short colorComponents[3], lightMultiplier;
     short fadeToPercent, radiusRounded;
     fixpt radius;
     char grid[DCOLS][DROWS];
@@ -61,14 +97,9 @@ boolean paintLight(lightSource *theLight, short x, short y, boolean isMinersLigh
 
     brogueAssert(rogue.RNG == RNG_SUBSTANTIVE);
 
-    radius = randClump(theLight->lightRadius) * FP_FACTOR / 100;
+    radius = rollLight(theLight, colorComponents);
     radiusRounded = fp_round(radius);
 
-    randComponent = rand_range(0, theLight->lightColor->rand);
-    colorComponents[0] = randComponent + theLight->lightColor->red + rand_range(0, theLight->lightColor->redRand);
-    colorComponents[1] = randComponent + theLight->lightColor->green + rand_range(0, theLight->lightColor->greenRand);
-    colorComponents[2] = randComponent + theLight->lightColor->blue + rand_range(0, theLight->lightColor->blueRand);
-
     // the miner's light does not dispel IS_IN_SHADOW,
     // so the player can be in shadow despite casting his own light.
     dispelShadows = !maintainShadows && (colorComponents[0] + colorComponents[1] + colorComponents[2]) > 0;
@@ -90,7 +121,7 @@ boolean paintLight(lightSource *theLight, short x, short y, boolean isMinersLigh
     for (i = max(0, x - radiusRounded); i < DCOLS && i < x + radiusRounded; i++) {
         for (j = max(0, y - radiusRounded); j < DROWS && j < y + radiusRounded; j++) {
             if (grid[i][j]) {
-                lightMultiplier =   100 - (100 - fadeToPercent) * fp_sqrt(((i-x) * (i-x) + (j-y) * (j-y)) * FP_FACTOR) / radius;
+                lightMultiplier = lightMultiplierAt(i - x, j - y, radius, fadeToPercent);
                 for (k=0; k<3; k++) {
                     tmap[i][j].light[k] += colorComponents[k] * lightMultiplier / 100;;
                 }
@@ -115,6 +146,162 @@ boolean paintLight(lightSource *theLight, short x, short y, boolean isMinersLigh
     return overlappedFieldOfView;
 }
 
+// Glowing terrain mostly lights the same cells turn after turn, so updateLighting keeps, for each
+// glowing layer of each cell, the cells its light reached and how strongly. What paintLight lights
+// depends only on the radius and on three things in the cells around the light: whether they
+// obstruct vision, whether a creature is standing in them and whether the player can see them.
+// Those are recorded for the whole map on every call, and a glow's cells are reused as long as
+// none of them has changed near it since the previous call.
+
+typedef struct litCell {
+    short x, y;
+    short multiplier;
+} litCell;
+
+typedef struct staticLight {
+    enum tileType tile;
+    fixpt radius;
+    short fadeToPercent;
+    unsigned long lightingPass; // the updateLighting call that last checked it
+    short cellCount, cellCapacity;
+    litCell *cells;
+} staticLight;
+
+#define LIGHTING_OBSTRUCTED     Fl(0)
+#define LIGHTING_OCCUPIED       Fl(1)
+#define LIGHTING_VISIBLE        Fl(2)
+
+static staticLight *staticLights[DCOLS][DROWS][NUMBER_TERRAIN_LAYERS];
+static unsigned long lightingPass = 0;
+static char lightingInputs[DCOLS][DROWS];
+static short lightingChanges[DCOLS + 1][DROWS + 1]; // summed-area table of the cells whose inputs changed
+
+void forgetStaticLights() {
+    short i, j;
+    enum dungeonLayers layer;
+
+    for (i = 0; i < DCOLS; i++) {
+        for (j = 0; j < DROWS; j++) {
+            for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
+                if (staticLights[i][j][layer]) {
+                    free(staticLights[i][j][layer]->cells);
+                    free(staticLights[i][j][layer]);
+                    staticLights[i][j][layer] = NULL;
+                }
+            }
+        }
+    }
+}
+
+static void recordLightingInputs() {
+    short i, j;
+    char inputs;
+
+    for (i = 0; i < DCOLS; i++) {
+        for (j = 0; j < DROWS; j++) {
+            inputs = 0;
+            if (cellHasTerrainFlag(i, j, T_OBSTRUCTS_VISION)) {
+                inputs |= LIGHTING_OBSTRUCTED;
+            }
+            if (pmap[i][j].flags & (HAS_MONSTER | HAS_PLAYER)) {
+                inputs |= LIGHTING_OCCUPIED;
+            }
+            if (pmap[i][j].flags & IN_FIELD_OF_VIEW) {
+                inputs |= LIGHTING_VISIBLE;
+            }
+            lightingChanges[i + 1][j + 1] = lightingChanges[i][j + 1] + lightingChanges[i + 1][j] - lightingChanges[i][j]
+                                            + (inputs != lightingInputs[i][j]);
+            lightingInputs[i][j] = inputs;
+        }
+    }
+    lightingPass++;
+}
+
+// Whether the inputs of any cell within the given distance of (x, y) changed since the previous call.
+static boolean lightingChangedNear(short x, short y, short distance) {
+    const short x1 = max(0, x - distance), y1 = max(0, y - distance);
+    const short x2 = min(DCOLS, x + distance + 1), y2 = min(DROWS, y + distance + 1);
+
+    return (lightingChanges[x2][y2] - lightingChanges[x1][y2] - lightingChanges[x2][y1] + lightingChanges[x1][y1]) > 0;
+}
+
+// Finds the cells that a glow of the given radius lights, as paintLight would, and remembers them.
+static void findStaticLightCells(staticLight *glow, lightSource *theLight, short x, short y, fixpt radius) {
+    short i, j, radiusRounded;
+    char grid[DCOLS][DROWS];
+
+    radiusRounded = fp_round(radius);
+    for (i = max(0, x - radiusRounded); i < DCOLS && i < x + radiusRounded; i++) {
+        for (j = max(0, y - radiusRounded); j < DROWS && j < y + radiusRounded; j++) {
+            grid[i][j] = 0;
+        }
+    }
+
+    getFOVMask(grid, x, y, radius, T_OBSTRUCTS_VISION, (theLight->passThroughCreatures ? 0 : (HAS_MONSTER | HAS_PLAYER)), true);
+
+    glow->radius = radius;
+    glow->fadeToPercent = theLight->radialFadeToPercent;
+    glow->cellCount = 0;
+    for (i = max(0, x - radiusRounded); i < DCOLS && i < x + radiusRounded; i++) {
+        for (j = max(0, y - radiusRounded); j < DROWS && j < y + radiusRounded; j++) {
+            if (grid[i][j]) {
+                if (glow->cellCount >= glow->cellCapacity) {
+                    glow->cellCapacity = max(32, glow->cellCapacity * 2);
+                    glow->cells = realloc(glow->cells, sizeof(litCell) * glow->cellCapacity);
+                }
+                glow->cells[glow->cellCount].x = i;
+                glow->cells[glow->cellCount].y = j;
+                glow->cells[glow->cellCount].multiplier = lightMultiplierAt(i - x, j - y, radius, glow->fadeToPercent);
+                glow->cellCount++;
+            }
+        }
+    }
+}
+
+// paintLight for the glow of the given layer of a cell, reusing the cells it lit last time where it can.
+static void paintStaticLight(lightSource *theLight, short x, short y, enum dungeonLayers layer) {
+    staticLight *glow = staticLights[x][y][layer];
+    short colorComponents[3], k;
+    const litCell *cell;
+    fixpt radius;
+    boolean dispelShadows;
+
+    brogueAssert(rogue.RNG == RNG_SUBSTANTIVE);
+
+    radius = rollLight(theLight, colorComponents);
+    dispelShadows = (colorComponents[0] + colorComponents[1] + colorComponents[2]) > 0;
+
+    if (!glow) {
+        glow = staticLights[x][y][layer] = calloc(1, sizeof(staticLight));
+    }
+    if (glow->lightingPass != lightingPass - 1
+        || glow->tile != pmap[x][y].layers[layer]
+        || glow->radius != radius
+        || glow->fadeToPercent != theLight->radialFadeToPercent
+        || lightingChangedNear(x, y, fp_round(radius) + 1)) {
+
+        glow->tile = pmap[x][y].layers[layer];
+        findStaticLightCells(glow, theLight, x, y, radius);
+    }
+    glow->lightingPass = lightingPass;
+
+    for (cell = glow->cells; cell < glow->cells + glow->cellCount; cell++) {
+        for (k=0; k<3; k++) {
+            tmap[cell->x][cell->y].light[k] += colorComponents[k] * cell->multiplier / 100;
+        }
+        if (dispelShadows) {
+            pmap[cell->x][cell->y].flags &= ~IS_IN_SHADOW;
+        }
+    }
+
+    tmap[x][y].light[0] += colorComponents[0];
+    tmap[x][y].light[1] += colorComponents[1];
+    tmap[x][y].light[2] += colorComponents[2];
+
+    if (dispelShadows) {
+        pmap[x][y].flags &= ~IS_IN_SHADOW;
+    }
+}
 
 // sets miner's light strength and characteristics based on rings of illumination, scrolls of darkness and water submersion
 void updateMinersLightRadius() {
@@ -225,12 +412,13 @@ void updateLighting() {
     }
 
     // Paint all glowing tiles.
+    recordLightingInputs();
     for (i = 0; i < DCOLS; i++) {
         for (j = 0; j < DROWS; j++) {
             for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
                 tile = pmap[i][j].layers[layer];
                 if (tileCatalog[tile].glowLight) {
-                    paintLight(&(lightCatalog[tileCatalog[tile].glowLight]), i, j, false, false);
+                    paintStaticLight(&(lightCatalog[tileCatalog[tile].glowLight]), i, j, layer);
                 }
             }
         }
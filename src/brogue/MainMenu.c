@@ -766,6 +766,7 @@ void mainBrogueJunction() {
                             break;
                         }
 #endif
+                        considerCapturingKeyframe();
                         rogue.RNG = RNG_COSMETIC; // dancing terrain colors can't influence recordings
                         rogue.playbackBetweenTurns = true;
                         nextBrogueEvent(&theEvent, false, true, false);
@@ -775,6 +776,7 @@ void mainBrogueJunction() {
                     }
 
                     freeEverything();
+                    freeKeyframes();
                 } else {
                     // announce file not found
                 }
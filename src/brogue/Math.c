@@ -185,6 +185,29 @@ uint64_t seedRandomGenerator(uint64_t seed) {
     return seed;
 }
 
+// Used by snapshots to save and restore the exact position of every RNG.
+void getRNGState(uint32_t state[NUMBER_OF_RNGS][4]) {
+    short i;
+
+    for (i=0; i<NUMBER_OF_RNGS; i++) {
+        state[i][0] = RNGState[i].a;
+        state[i][1] = RNGState[i].b;
+        state[i][2] = RNGState[i].c;
+        state[i][3] = RNGState[i].d;
+    }
+}
+
+void setRNGState(uint32_t state[NUMBER_OF_RNGS][4]) {
+    short i;
+
+    for (i=0; i<NUMBER_OF_RNGS; i++) {
+        RNGState[i].a = state[i][0];
+        RNGState[i].b = state[i][1];
+        RNGState[i].c = state[i][2];
+        RNGState[i].d = state[i][3];
+    }
+}
+
 
     // Fixed-point arithmetic
 
@@ -734,6 +734,7 @@ boolean drawManacle(short x, short y, enum directions dir) {
         && pmap[newX][newY].layers[LIQUID] == NOTHING) {
 
         pmap[x + nbDirs[dir][0]][y + nbDirs[dir][1]].layers[SURFACE] = manacles[dir];
+        refreshTerrainFlags(newX, newY);
         return true;
     }
     return false;
@@ -886,6 +887,9 @@ boolean removeMonsterFromChain(creature *monst, creature *theChain) {
          previousMonster = previousMonster->nextCreature) {
         if (previousMonster->nextCreature == monst) {
             previousMonster->nextCreature = monst->nextCreature;
+            if (theChain == monsters) {
+                forgetMonsterLocation(monst);
+            }
             return true;
         }
     }
@@ -1949,6 +1953,27 @@ boolean openPathBetween(short x1, short y1, short x2, short y2) {
     return false;
 }
 
+// The monster last seen at each location, so that monsterAtLoc() seldom has to search the chain.
+// An entry is only trusted while that monster is still standing there, and monsters are forgotten
+// as they leave the chain, so no entry outlives the monster it points to.
+static creature *monstersByLocation[DCOLS][DROWS];
+
+void forgetMonsterLocations() {
+    memset(monstersByLocation, 0, sizeof(monstersByLocation));
+}
+
+void forgetMonsterLocation(creature *monst) {
+    short i, j;
+
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            if (monstersByLocation[i][j] == monst) {
+                monstersByLocation[i][j] = NULL;
+            }
+        }
+    }
+}
+
 // will return the player if the player is at (x, y).
 creature *monsterAtLoc(short x, short y) {
     creature *monst;
@@ -1958,7 +1983,11 @@ creature *monsterAtLoc(short x, short y) {
     if (player.xLoc == x && player.yLoc == y) {
         return &player;
     }
-    for (monst = monsters->nextCreature; monst != NULL && (monst->xLoc != x || monst->yLoc != y); monst = monst->nextCreature);
+    monst = monstersByLocation[x][y];
+    if (monst == NULL || monst->xLoc != x || monst->yLoc != y) {
+        for (monst = monsters->nextCreature; monst != NULL && (monst->xLoc != x || monst->yLoc != y); monst = monst->nextCreature);
+        monstersByLocation[x][y] = monst;
+    }
     return monst;
 }
 
@@ -2627,9 +2656,8 @@ boolean isLocalScentMaximum(short x, short y) {
 
 // Returns the direction the player's scent points to from a given cell. Returns -1 if the nose comes up blank.
 enum directions scentDirection(creature *monst) {
-    short newX, newY, x, y, newestX, newestY;
-    enum directions bestDirection = NO_DIRECTION, dir, dir2;
-    unsigned short bestNearbyScent = 0;
+    short newX, newY, x, y, newestX, newestY, stepCount, i;
+    enum directions dir, dir2, steps[DIRECTION_COUNT];
     boolean canTryAgain = true;
     creature *otherMonst;
 
@@ -2638,26 +2666,40 @@ enum directions scentDirection(creature *monst) {
 
     for (;;) {
 
+        // Only a neighbor with more scent than here will do, and the strongest one that the monster
+        // can step into wins, lower directions first among equals. So the neighbors are tried from
+        // the strongest scent down, and the passability tests stop at the first that passes.
+        stepCount = 0;
         for (dir=0; dir< DIRECTION_COUNT; dir++) {
             newX = x + nbDirs[dir][0];
             newY = y + nbDirs[dir][1];
-            otherMonst = monsterAtLoc(newX, newY);
             if (coordinatesAreInMap(newX, newY)
-                && (scentMap[newX][newY] > bestNearbyScent)
-                && (!(pmap[newX][newY].flags & HAS_MONSTER) || (otherMonst && canPass(monst, otherMonst)))
+                && scentMap[newX][newY] > scentMap[x][y]) {
+
+                for (i = stepCount;
+                     i > 0 && scentMap[x + nbDirs[steps[i - 1]][0]][y + nbDirs[steps[i - 1]][1]] < scentMap[newX][newY];
+                     i--) {
+
+                    steps[i] = steps[i - 1];
+                }
+                steps[i] = dir;
+                stepCount++;
+            }
+        }
+
+        for (i = 0; i < stepCount; i++) {
+            newX = x + nbDirs[steps[i]][0];
+            newY = y + nbDirs[steps[i]][1];
+            if ((!(pmap[newX][newY].flags & HAS_MONSTER)
+                 || ((otherMonst = monsterAtLoc(newX, newY)) && canPass(monst, otherMonst)))
                 && !cellHasTerrainFlag(newX, newY, T_OBSTRUCTS_PASSABILITY)
                 && !diagonalBlocked(x, y, newX, newY, false)
                 && !monsterAvoids(monst, newX, newY)) {
 
-                bestNearbyScent = scentMap[newX][newY];
-                bestDirection = dir;
+                return steps[i];
             }
         }
 
-        if (bestDirection >= 0 && bestNearbyScent > scentMap[x][y]) {
-            return bestDirection;
-        }
-
         if (canTryAgain) {
             // Okay, the monster may be stuck in some irritating diagonal.
             // If so, we can diffuse the scent into the offending kink and solve the problem.
@@ -3442,6 +3484,12 @@ void setMonsterLocation(creature *monst, short newX, short newY) {
     pmap[monst->xLoc][monst->yLoc].flags &= ~creatureFlag;
     refreshDungeonCell(monst->xLoc, monst->yLoc);
     monst->turnsSpentStationary = 0;
+    if (monst != &player && !(monst->bookkeepingFlags & MB_IS_DORMANT)) {
+        if (monstersByLocation[monst->xLoc][monst->yLoc] == monst) {
+            monstersByLocation[monst->xLoc][monst->yLoc] = NULL;
+        }
+        monstersByLocation[newX][newY] = monst;
+    }
     monst->xLoc = newX;
     monst->yLoc = newY;
     pmap[newX][newY].flags |= creatureFlag;
@@ -3531,6 +3579,7 @@ boolean moveMonster(creature *monst, short dx, short dy) {
             return true;
         } else if (tileCatalog[pmap[x][y].layers[SURFACE]].flags & T_ENTANGLES) {
             pmap[x][y].layers[SURFACE] = NOTHING;
+            refreshTerrainFlags(x, y);
         }
     }
 
@@ -3940,6 +3989,7 @@ void toggleMonsterDormancy(creature *monst) {
             // Found it! It's alive. Put it into dormancy.
             // Remove it from the monsters chain.
             prevMonst->nextCreature = monst->nextCreature;
+            forgetMonsterLocation(monst);
             // Add it to the dormant chain.
             monst->nextCreature = dormantMonsters->nextCreature;
             dormantMonsters->nextCreature = monst;
@@ -237,21 +237,21 @@ void describeLocation(char *buf, short x, short y) {
 
     if (!playerCanSeeOrSense(x, y)) {
         if (pmap[x][y].flags & DISCOVERED) { // memory
-            if (pmap[x][y].rememberedItemCategory) {
+            if (rmap[x][y].rememberedItemCategory) {
                 if (player.status[STATUS_HALLUCINATING] && !rogue.playbackOmniscience) {
                     describeHallucinatedItem(object);
                 } else {
-                    describedItemBasedOnParameters(pmap[x][y].rememberedItemCategory, pmap[x][y].rememberedItemKind,
-                                                   pmap[x][y].rememberedItemQuantity, pmap[x][y].rememberedItemOriginDepth, object);
+                    describedItemBasedOnParameters(rmap[x][y].rememberedItemCategory, rmap[x][y].rememberedItemKind,
+                                                   rmap[x][y].rememberedItemQuantity, rmap[x][y].rememberedItemOriginDepth, object);
                 }
             } else {
-                strcpy(object, tileCatalog[pmap[x][y].rememberedTerrain].description);
+                strcpy(object, tileCatalog[rmap[x][y].rememberedTerrain].description);
             }
             sprintf(buf, "you remember seeing %s here.", object);
             restoreRNG;
             return;
         } else if (pmap[x][y].flags & MAGIC_MAPPED) { // magic mapped
-            sprintf(buf, "you expect %s to be here.", tileCatalog[pmap[x][y].rememberedTerrain].description);
+            sprintf(buf, "you expect %s to be here.", tileCatalog[rmap[x][y].rememberedTerrain].description);
             restoreRNG;
             return;
         }
@@ -855,6 +855,7 @@ boolean playerMoves(short direction) {
                 }
                 if (tileCatalog[pmap[x][y].layers[SURFACE]].flags & T_ENTANGLES) {
                     pmap[x][y].layers[SURFACE] = NOTHING;
+                    refreshTerrainFlags(x, y);
                 }
             }
             moveEntrancedMonsters(direction);
@@ -1088,6 +1089,7 @@ boolean playerMoves(short direction) {
                 }
                 if (tileCatalog[pmap[x][y].layers[SURFACE]].flags & T_ENTANGLES) {
                     pmap[x][y].layers[SURFACE] = NOTHING;
+                    refreshTerrainFlags(x, y);
                 }
             }
         }
@@ -1428,55 +1430,139 @@ void calculateDistances(short **distanceMap, short destinationX, short destinati
     } while (somethingChanged);
 }*/
 
-// Returns -1 if there are no beneficial moves.
-// If preferDiagonals is true, we will prefer diagonal moves.
-// Always rolls downhill on the distance map.
-// If monst is provided, do not return a direction pointing to
-// a cell that the monster avoids.
-short nextStep(short **distanceMap, short x, short y, creature *monst, boolean preferDiagonals) {
-    short newX, newY, bestScore;
-    enum directions dir, bestDir;
-    creature *blocker;
-    boolean blocked;
+// The downhill steps out of the cells of the distance maps that many monsters roll down, such as
+// the waypoint maps: for each cell, the directions to the lower neighbors, steepest first and in
+// direction order among equally steep ones. A cell's list is made the first time anyone asks for
+// it and then serves every monster that stands there, until the map is next written.
+typedef struct downhillTable {
+    short **distanceMap;
+    signed char stepCount[DCOLS][DROWS]; // -1 until the cell's steps are listed
+    signed char steps[DCOLS][DROWS][DIRECTION_COUNT];
+} downhillTable;
 
-    brogueAssert(coordinatesAreInMap(x, y));
+static downhillTable downhillTables[MAX_WAYPOINT_COUNT];
+static short downhillTableCount = 0;
+static short nextDownhillTable = 0;
 
-    bestScore = 0;
-    bestDir = NO_DIRECTION;
+// Called whenever a distance map that is shared by many monsters has been written.
+void shareDownhillSteps(short **distanceMap) {
+    downhillTable *table;
 
-    for (dir = (preferDiagonals ? 7 : 0);
-         (preferDiagonals ? dir >= 0 : dir < DIRECTION_COUNT);
-         (preferDiagonals ? dir-- : dir++)) {
+    for (table = downhillTables; table < downhillTables + downhillTableCount; table++) {
+        if (table->distanceMap == distanceMap) {
+            break;
+        }
+    }
+    if (table == downhillTables + downhillTableCount) {
+        if (downhillTableCount < MAX_WAYPOINT_COUNT) {
+            downhillTableCount++;
+        } else {
+            table = &downhillTables[nextDownhillTable];
+            nextDownhillTable = (nextDownhillTable + 1) % MAX_WAYPOINT_COUNT;
+        }
+    }
+    table->distanceMap = distanceMap;
+    memset(table->stepCount, -1, sizeof(table->stepCount));
+}
+
+void forgetDownhillSteps() {
+    downhillTableCount = 0;
+    nextDownhillTable = 0;
+}
 
+// Lists the directions from (x, y) to neighbors that are lower on the map, steepest first, and returns how many there are.
+static short listDownhillSteps(short **distanceMap, short x, short y, signed char steps[DIRECTION_COUNT]) {
+    short newX, newY, drop, stepCount, i;
+    enum directions dir;
+
+    stepCount = 0;
+    for (dir = 0; dir < DIRECTION_COUNT; dir++) {
         newX = x + nbDirs[dir][0];
         newY = y + nbDirs[dir][1];
-
         brogueAssert(coordinatesAreInMap(newX, newY));
         if (coordinatesAreInMap(newX, newY)) {
-            blocked = false;
-            blocker = monsterAtLoc(newX, newY);
-            if (monst
-                && monsterAvoids(monst, newX, newY)) {
+            drop = distanceMap[x][y] - distanceMap[newX][newY];
+            if (drop > 0) {
+                for (i = stepCount;
+                     i > 0 && distanceMap[x][y] - distanceMap[x + nbDirs[steps[i - 1]][0]][y + nbDirs[steps[i - 1]][1]] < drop;
+                     i--) {
 
-                blocked = true;
-            } else if (monst
-                       && blocker
-                       && !canPass(monst, blocker)
-                       && !monstersAreTeammates(monst, blocker)
-                       && !monstersAreEnemies(monst, blocker)) {
-                blocked = true;
+                    steps[i] = steps[i - 1];
+                }
+                steps[i] = dir;
+                stepCount++;
             }
-            if ((distanceMap[x][y] - distanceMap[newX][newY]) > bestScore
-                && !diagonalBlocked(x, y, newX, newY, monst == &player)
-                && knownToPlayerAsPassableOrSecretDoor(newX, newY)
-                && !blocked) {
+        }
+    }
+    return stepCount;
+}
+
+static boolean canStepDownhill(short x, short y, enum directions dir, creature *monst) {
+    const short newX = x + nbDirs[dir][0];
+    const short newY = y + nbDirs[dir][1];
+    creature *blocker;
+
+    if (diagonalBlocked(x, y, newX, newY, monst == &player)
+        || !knownToPlayerAsPassableOrSecretDoor(newX, newY)) {
+        return false;
+    }
+    if (monst) {
+        if (monsterAvoids(monst, newX, newY)) {
+            return false;
+        }
+        blocker = monsterAtLoc(newX, newY);
+        if (blocker
+            && !canPass(monst, blocker)
+            && !monstersAreTeammates(monst, blocker)
+            && !monstersAreEnemies(monst, blocker)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns -1 if there are no beneficial moves.
+// If preferDiagonals is true, we will prefer diagonal moves.
+// Always rolls downhill on the distance map.
+// If monst is provided, do not return a direction pointing to
+// a cell that the monster avoids.
+short nextStep(short **distanceMap, short x, short y, creature *monst, boolean preferDiagonals) {
+    signed char localSteps[DIRECTION_COUNT], *steps;
+    short stepCount, drop, first, last, i;
+    downhillTable *table;
 
-                bestDir = dir;
-                bestScore = distanceMap[x][y] - distanceMap[newX][newY];
+    brogueAssert(coordinatesAreInMap(x, y));
+
+    for (table = downhillTables; table < downhillTables + downhillTableCount; table++) {
+        if (table->distanceMap == distanceMap) {
+            break;
+        }
+    }
+    if (table < downhillTables + downhillTableCount) {
+        if (table->stepCount[x][y] < 0) {
+            table->stepCount[x][y] = listDownhillSteps(distanceMap, x, y, table->steps[x][y]);
+        }
+        steps = table->steps[x][y];
+        stepCount = table->stepCount[x][y];
+    } else {
+        steps = localSteps;
+        stepCount = listDownhillSteps(distanceMap, x, y, localSteps);
+    }
+
+    // The steepest step the monster can take wins. Among equally steep ones, the scan order decides,
+    // and preferDiagonals scans the directions backward so that the diagonals come first.
+    for (first = 0; first < stepCount; first = last) {
+        drop = distanceMap[x][y] - distanceMap[x + nbDirs[steps[first]][0]][y + nbDirs[steps[first]][1]];
+        for (last = first + 1;
+             last < stepCount && distanceMap[x][y] - distanceMap[x + nbDirs[steps[last]][0]][y + nbDirs[steps[last]][1]] == drop;
+             last++);
+        for (i = (preferDiagonals ? last - 1 : first); (preferDiagonals ? i >= first : i < last); (preferDiagonals ? i-- : i++)) {
+            if (canStepDownhill(x, y, steps[i], monst)) {
+                return steps[i];
             }
         }
     }
-    return bestDir;
+    return NO_DIRECTION;
 }
 
 void displayRoute(short **distanceMap, boolean removeRoute) {
@@ -1706,13 +1792,13 @@ void getLocationFlags(const short x, const short y,
         && !playerCanSee(x, y)) {
 
         if (tFlags) {
-            *tFlags = pmap[x][y].rememberedTerrainFlags;
+            *tFlags = rmap[x][y].rememberedTerrainFlags;
         }
         if (TMFlags) {
-            *TMFlags = pmap[x][y].rememberedTMFlags;
+            *TMFlags = rmap[x][y].rememberedTMFlags;
         }
         if (cellFlags) {
-            *cellFlags = pmap[x][y].rememberedCellFlags;
+            *cellFlags = rmap[x][y].rememberedCellFlags;
         }
     } else {
         if (tFlags) {
@@ -2113,6 +2199,7 @@ void discover(short x, short y) {
             if (tileCatalog[pmap[x][y].layers[layer]].mechFlags & TM_IS_SECRET) {
                 feat = &dungeonFeatureCatalog[tileCatalog[pmap[x][y].layers[layer]].discoverType];
                 pmap[x][y].layers[layer] = (layer == DUNGEON ? FLOOR : NOTHING);
+                refreshTerrainFlags(x, y);
                 spawnDungeonFeature(x, y, feat, true, false);
             }
         }
@@ -2228,10 +2315,10 @@ boolean useStairs(short stairDirection) {
 }
 
 void storeMemories(const short x, const short y) {
-    pmap[x][y].rememberedTerrainFlags = terrainFlags(x, y);
-    pmap[x][y].rememberedTMFlags = terrainMechFlags(x, y);
-    pmap[x][y].rememberedCellFlags = pmap[x][y].flags;
-    pmap[x][y].rememberedTerrain = pmap[x][y].layers[highestPriorityLayer(x, y, false)];
+    rmap[x][y].rememberedTerrainFlags = terrainFlags(x, y);
+    rmap[x][y].rememberedTMFlags = terrainMechFlags(x, y);
+    rmap[x][y].rememberedCellFlags = pmap[x][y].flags;
+    rmap[x][y].rememberedTerrain = pmap[x][y].layers[highestPriorityLayer(x, y, false)];
 }
 
 void updateFieldOfViewDisplay(boolean updateDancingTerrain, boolean refreshDisplay) {
@@ -2377,32 +2464,76 @@ void betweenOctant1andN(short *x, short *y, short x0, short y0, short n) {
     }
 }
 
-// Returns a boolean grid indicating whether each square is in the field of view of (xLoc, yLoc).
-// forbiddenTerrain is the set of terrain flags that will block vision (but the blocking cell itself is
-// illuminated); forbiddenFlags is the set of map flags that will block vision.
-// If cautiousOnWalls is set, we will not illuminate blocking tiles unless the tile one space closer to the origin
-// is visible to the player; this is to prevent lights from illuminating a wall when the player is on the other
-// side of the wall.
-void getFOVMask(char grid[DCOLS][DROWS], short xLoc, short yLoc, fixpt maxRadius,
-                unsigned long forbiddenTerrain, unsigned long forbiddenFlags, boolean cautiousOnWalls) {
-    short i;
+// The octant transforms of betweenOctant1andN as coefficients: a cell that is columnsRightFromOrigin
+// to the right of the origin and i below it in octant 1 is at
+// (xLoc + xx * columnsRightFromOrigin + xy * i, yLoc + yx * columnsRightFromOrigin + yy * i) in octant n.
+static const short octantTransforms[9][4] = {
+    {0, 0, 0, 0},   // (no octant 0)
+    {1, 0, 0, 1},
+    {1, 0, 0, -1},
+    {0, -1, 1, 0},
+    {0, 1, 1, 0},
+    {-1, 0, 0, -1},
+    {-1, 0, 0, 1},
+    {0, 1, -1, 0},
+    {0, -1, -1, 0},
+};
+
+typedef struct fovScan {
+    char (*grid)[DROWS];
+    short xLoc, yLoc;
+    short xx, xy, yx, yy;
+    fixpt maxRadius, radiusSquared;
+    unsigned long forbiddenTerrain, forbiddenFlags;
+    boolean cautiousOnWalls;
+} fovScan;
+
+// The top of the visible circle in each column, for the radius that was last asked about.
+// Lights of the same radius share it, so the square root is taken once per column rather
+// than once per column per octant per call.
+#define FOV_CIRCLE_COLUMNS  (DCOLS + DROWS)
+static fixpt fovCircleRadius = -1;
+static short fovCircleTop[FOV_CIRCLE_COLUMNS];
+static boolean fovCircleTopKnown[FOV_CIRCLE_COLUMNS];
+
+static short fovCircleTopInColumn(fixpt maxRadius, short columnsRightFromOrigin) {
+    if (columnsRightFromOrigin >= FOV_CIRCLE_COLUMNS) {
+        return (int) (-1 * fp_sqrt((maxRadius*maxRadius / FP_FACTOR) - (columnsRightFromOrigin*columnsRightFromOrigin * FP_FACTOR)) / FP_FACTOR);
+    }
+    if (maxRadius != fovCircleRadius) {
+        fovCircleRadius = maxRadius;
+        memset(fovCircleTopKnown, 0, sizeof(fovCircleTopKnown));
+    }
+    if (!fovCircleTopKnown[columnsRightFromOrigin]) {
+        fovCircleTop[columnsRightFromOrigin] = (int) (-1 * fp_sqrt((maxRadius*maxRadius / FP_FACTOR) - (columnsRightFromOrigin*columnsRightFromOrigin * FP_FACTOR)) / FP_FACTOR);
+        fovCircleTopKnown[columnsRightFromOrigin] = true;
+    }
+    return fovCircleTop[columnsRightFromOrigin];
+}
 
-    for (i=1; i<=8; i++) {
-        scanOctantFOV(grid, xLoc, yLoc, i, maxRadius, 1, LOS_SLOPE_GRANULARITY * -1, 0,
-                      forbiddenTerrain, forbiddenFlags, cautiousOnWalls);
+// Narrows [*lo, *hi] to the values of i for which base + k * i is in [0, limit).
+// Returns false if none are.
+static boolean clipFOVSpanToMap(short base, short k, short limit, short *lo, short *hi) {
+    if (k == 0) {
+        return (base >= 0 && base < limit);
+    } else if (k > 0) {
+        *lo = max(*lo, -base);
+        *hi = min(*hi, limit - 1 - base);
+    } else {
+        *lo = max(*lo, base - (limit - 1));
+        *hi = min(*hi, base);
     }
+    return (*lo <= *hi);
 }
 
 // This is a custom implementation of recursive shadowcasting.
-void scanOctantFOV(char grid[DCOLS][DROWS], short xLoc, short yLoc, short octant, fixpt maxRadius,
-                   short columnsRightFromOrigin, long startSlope, long endSlope, unsigned long forbiddenTerrain,
-                   unsigned long forbiddenFlags, boolean cautiousOnWalls) {
+static void scanOctantFOV(const fovScan *scan, short columnsRightFromOrigin, long startSlope, long endSlope) {
 
-    if (columnsRightFromOrigin * FP_FACTOR >= maxRadius) return;
+    if (columnsRightFromOrigin * FP_FACTOR >= scan->maxRadius) return;
 
-    short i, a, b, iStart, iEnd, x, y, x2, y2; // x and y are temporary variables on which we do the octant transform
+    short i, a, b, iStart, iEnd, lo, hi, x, y, x2, y2, i2, columnX, columnY;
     long newStartSlope, newEndSlope;
-    boolean cellObstructed;
+    boolean cellObstructed, currentlyLit;
 
     newStartSlope = startSlope;
 
@@ -2413,46 +2544,45 @@ void scanOctantFOV(char grid[DCOLS][DROWS], short xLoc, short yLoc, short octant
     iEnd = max(a, b);
 
     // restrict vision to a circle of radius maxRadius
-    if ((columnsRightFromOrigin*columnsRightFromOrigin + iEnd*iEnd) >= maxRadius*maxRadius / FP_FACTOR / FP_FACTOR) {
+    if ((columnsRightFromOrigin*columnsRightFromOrigin + iEnd*iEnd) >= scan->radiusSquared) {
         return;
     }
-    if ((columnsRightFromOrigin*columnsRightFromOrigin + iStart*iStart) >= maxRadius*maxRadius / FP_FACTOR / FP_FACTOR) {
-        iStart = (int) (-1 * fp_sqrt((maxRadius*maxRadius / FP_FACTOR) - (columnsRightFromOrigin*columnsRightFromOrigin * FP_FACTOR)) / FP_FACTOR);
-    }
-
-    x = xLoc + columnsRightFromOrigin;
-    y = yLoc + iStart;
-    betweenOctant1andN(&x, &y, xLoc, yLoc, octant);
-    boolean currentlyLit = coordinatesAreInMap(x, y) && !(cellHasTerrainFlag(x, y, forbiddenTerrain) ||
-                                                          (pmap[x][y].flags & forbiddenFlags));
-    for (i = iStart; i <= iEnd; i++) {
-        x = xLoc + columnsRightFromOrigin;
-        y = yLoc + i;
-        betweenOctant1andN(&x, &y, xLoc, yLoc, octant);
-        if (!coordinatesAreInMap(x, y)) {
-            // We're off the map -- here there be memory corruption.
-            continue;
-        }
-        cellObstructed = (cellHasTerrainFlag(x, y, forbiddenTerrain) || (pmap[x][y].flags & forbiddenFlags));
+    if ((columnsRightFromOrigin*columnsRightFromOrigin + iStart*iStart) >= scan->radiusSquared) {
+        iStart = fovCircleTopInColumn(scan->maxRadius, columnsRightFromOrigin);
+    }
+
+    // Cells off the map are skipped, so only the stretch of the column that is on the map is scanned.
+    columnX = scan->xLoc + scan->xx * columnsRightFromOrigin;
+    columnY = scan->yLoc + scan->yx * columnsRightFromOrigin;
+    lo = iStart;
+    hi = iEnd;
+    if (!clipFOVSpanToMap(columnX, scan->xy, DCOLS, &lo, &hi)
+        || !clipFOVSpanToMap(columnY, scan->yy, DROWS, &lo, &hi)) {
+        return;
+    }
+
+    x = columnX + scan->xy * lo;
+    y = columnY + scan->yy * lo;
+    currentlyLit = (lo == iStart) && !(cellHasTerrainFlag(x, y, scan->forbiddenTerrain) ||
+                                       (pmap[x][y].flags & scan->forbiddenFlags));
+    for (i = lo; i <= hi; i++) {
+        x = columnX + scan->xy * i;
+        y = columnY + scan->yy * i;
+        cellObstructed = (cellHasTerrainFlag(x, y, scan->forbiddenTerrain) || (pmap[x][y].flags & scan->forbiddenFlags));
         // if we're cautious on walls and this is a wall:
-        if (cautiousOnWalls && cellObstructed) {
+        if (scan->cautiousOnWalls && cellObstructed) {
             // (x2, y2) is the tile one space closer to the origin from the tile we're on:
-            x2 = xLoc + columnsRightFromOrigin - 1;
-            y2 = yLoc + i;
-            if (i < 0) {
-                y2++;
-            } else if (i > 0) {
-                y2--;
-            }
-            betweenOctant1andN(&x2, &y2, xLoc, yLoc, octant);
+            i2 = (i < 0 ? i + 1 : i > 0 ? i - 1 : 0);
+            x2 = columnX - scan->xx + scan->xy * i2;
+            y2 = columnY - scan->yx + scan->yy * i2;
 
             if (pmap[x2][y2].flags & IN_FIELD_OF_VIEW) {
                 // previous tile is visible, so illuminate
-                grid[x][y] = 1;
+                scan->grid[x][y] = 1;
             }
         } else {
             // illuminate
-            grid[x][y] = 1;
+            scan->grid[x][y] = 1;
         }
         if (!cellObstructed && !currentlyLit) { // next column slope starts here
             newStartSlope = (long int) ((LOS_SLOPE_GRANULARITY * (i) - LOS_SLOPE_GRANULARITY / 2) / (columnsRightFromOrigin * 2 + 1) * 2);
@@ -2462,8 +2592,7 @@ void scanOctantFOV(char grid[DCOLS][DROWS], short xLoc, short yLoc, short octant
                             / (columnsRightFromOrigin * 2 - 1) * 2);
             if (newStartSlope <= newEndSlope) {
                 // run next column
-                scanOctantFOV(grid, xLoc, yLoc, octant, maxRadius, columnsRightFromOrigin + 1, newStartSlope, newEndSlope,
-                              forbiddenTerrain, forbiddenFlags, cautiousOnWalls);
+                scanOctantFOV(scan, columnsRightFromOrigin + 1, newStartSlope, newEndSlope);
             }
             currentlyLit = false;
         }
@@ -2472,12 +2601,40 @@ void scanOctantFOV(char grid[DCOLS][DROWS], short xLoc, short yLoc, short octant
         newEndSlope = endSlope;
         if (newStartSlope <= newEndSlope) {
             // run next column
-            scanOctantFOV(grid, xLoc, yLoc, octant, maxRadius, columnsRightFromOrigin + 1, newStartSlope, newEndSlope,
-                          forbiddenTerrain, forbiddenFlags, cautiousOnWalls);
+            scanOctantFOV(scan, columnsRightFromOrigin + 1, newStartSlope, newEndSlope);
         }
     }
 }
 
+// Returns a boolean grid indicating whether each square is in the field of view of (xLoc, yLoc).
+// forbiddenTerrain is the set of terrain flags that will block vision (but the blocking cell itself is
+// illuminated); forbiddenFlags is the set of map flags that will block vision.
+// If cautiousOnWalls is set, we will not illuminate blocking tiles unless the tile one space closer to the origin
+// is visible to the player; this is to prevent lights from illuminating a wall when the player is on the other
+// side of the wall.
+void getFOVMask(char grid[DCOLS][DROWS], short xLoc, short yLoc, fixpt maxRadius,
+                unsigned long forbiddenTerrain, unsigned long forbiddenFlags, boolean cautiousOnWalls) {
+    fovScan scan;
+    short i;
+
+    scan.grid = grid;
+    scan.xLoc = xLoc;
+    scan.yLoc = yLoc;
+    scan.maxRadius = maxRadius;
+    scan.radiusSquared = maxRadius*maxRadius / FP_FACTOR / FP_FACTOR;
+    scan.forbiddenTerrain = forbiddenTerrain;
+    scan.forbiddenFlags = forbiddenFlags;
+    scan.cautiousOnWalls = cautiousOnWalls;
+
+    for (i=1; i<=8; i++) {
+        scan.xx = octantTransforms[i][0];
+        scan.xy = octantTransforms[i][1];
+        scan.yx = octantTransforms[i][2];
+        scan.yy = octantTransforms[i][3];
+        scanOctantFOV(&scan, 1, LOS_SLOPE_GRANULARITY * -1, 0);
+    }
+}
+
 void addScentToCell(short x, short y, short distance) {
     unsigned short value;
     if (!cellHasTerrainFlag(x, y, T_OBSTRUCTS_SCENT) || !cellHasTerrainFlag(x, y, T_OBSTRUCTS_PASSABILITY)) {
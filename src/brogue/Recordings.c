@@ -653,9 +653,70 @@ void printPlaybackHelpScreen() {
     overlayDisplayBuffer(rbuf, NULL);
 }
 
+// Snapshots taken every KEYFRAME_INTERVAL turns while a recording plays, oldest first,
+// so that seeking can start from the nearest one instead of from the first turn.
+static snapshot **keyframes = NULL;
+static short keyframeCount = 0;
+static short keyframeCapacity = 0;
+static unsigned long nextKeyframeTurn = 0;
+
+// Call only between top-level events, never from inside a command that is still reading input.
+void considerCapturingKeyframe() {
+    snapshot *theKeyframe;
+
+    if (!rogue.playbackMode || rogue.playbackOOS || rogue.gameHasEnded
+        || rogue.playerTurnNumber < nextKeyframeTurn) {
+        return;
+    }
+    nextKeyframeTurn = rogue.playerTurnNumber + KEYFRAME_INTERVAL;
+
+    theKeyframe = captureSnapshot(keyframeCount ? keyframes[keyframeCount - 1] : NULL);
+    if (theKeyframe) {
+        if (keyframeCount >= keyframeCapacity) {
+            keyframeCapacity = max(16, keyframeCapacity * 2);
+            keyframes = realloc(keyframes, sizeof(snapshot *) * keyframeCapacity);
+        }
+        keyframes[keyframeCount++] = theKeyframe;
+    }
+}
+
+// Keyframes share level maps with their predecessors, so they are only ever freed all together.
+void freeKeyframes() {
+    short i;
+
+    for (i = 0; i < keyframeCount; i++) {
+        freeSnapshot(keyframes[i]);
+    }
+    free(keyframes);
+    keyframes = NULL;
+    keyframeCount = keyframeCapacity = 0;
+    nextKeyframeTurn = 0;
+}
+
+static snapshot *latestKeyframeUpTo(unsigned long turnNumber) {
+    short i;
+
+    for (i = keyframeCount - 1; i >= 0; i--) {
+        if (keyframes[i]->playerTurnNumber <= turnNumber) {
+            return keyframes[i];
+        }
+    }
+    return NULL;
+}
+
+static boolean restoreKeyframe(snapshot *theKeyframe) {
+    if (!restoreSnapshot(theKeyframe)) {
+        return false;
+    }
+    positionInPlaybackFile = recordingLocation;
+    fillBufferFromFile();
+    return true;
+}
+
 void advanceToLocation(unsigned long destinationFrame) {
     unsigned long progressBarInterval, initialFrameNumber;
     rogueEvent theEvent;
+    snapshot *theKeyframe;
     boolean useProgressBar, omniscient, stealth, trueColors;
 
     omniscient = rogue.playbackOmniscience;
@@ -667,7 +728,17 @@ void advanceToLocation(unsigned long destinationFrame) {
 
     cellDisplayBuffer dbuf[COLS][ROWS];
 
-    if (destinationFrame < rogue.playerTurnNumber) {
+    theKeyframe = latestKeyframeUpTo(destinationFrame);
+    if (theKeyframe
+        && (destinationFrame < rogue.playerTurnNumber || theKeyframe->playerTurnNumber > rogue.playerTurnNumber)
+        && restoreKeyframe(theKeyframe)) {
+
+        // Skip straight to the nearest keyframe; only the turns after it need replaying.
+        useProgressBar = (destinationFrame - rogue.playerTurnNumber > 100 ? true : false);
+        if (useProgressBar) {
+            blackOutScreen();
+        }
+    } else if (destinationFrame < rogue.playerTurnNumber) {
         useProgressBar = (destinationFrame > 100 ? true : false);
 
         // Start the recording over, and fast-forward to chosen frame.
@@ -709,6 +780,7 @@ void advanceToLocation(unsigned long destinationFrame) {
             rogue.playbackFastForward = true;
         }
 
+        considerCapturingKeyframe();
         rogue.RNG = RNG_COSMETIC; // dancing terrain colors can't influence recordings
         rogue.playbackDelayThisTurn = 0;
         nextBrogueEvent(&theEvent, false, true, false);
@@ -841,6 +913,7 @@ boolean executePlaybackInput(rogueEvent *recordingInput) {
                         rogue.playbackFastForward = true;
                         while ((rogue.deepestLevel <= previousDeepestLevel || !rogue.playbackBetweenTurns)
                                && !rogue.gameHasEnded) {
+                            considerCapturingKeyframe();
                             rogue.RNG = RNG_COSMETIC; // dancing terrain colors can't influence recordings
                             nextBrogueEvent(&theEvent, false, true, false);
                             rogue.RNG = RNG_SUBSTANTIVE;
@@ -903,6 +976,7 @@ boolean executePlaybackInput(rogueEvent *recordingInput) {
                     // advance by the right number of turns
                     if (!rogue.playbackPaused || unpause()) {
                         while (rogue.playerTurnNumber < destinationFrame && !rogue.gameHasEnded && !rogue.playbackOOS) {
+                            considerCapturingKeyframe();
                             rogue.RNG = RNG_COSMETIC; // dancing terrain colors can't influence recordings
                             rogue.playbackDelayThisTurn = 0;
                             nextBrogueEvent(&theEvent, false, true, false);
@@ -1088,14 +1162,59 @@ boolean characterForbiddenInFilename(const char theChar) {
     }
 }
 
+// Appends the state of the game after the recorded events, where loadSavedGame can restore it
+// directly. Older versions stop reading at lengthOfPlaybackFile and never see it.
+static void appendSnapshotToSavedGame(char *filePath, const snapshot *theSnapshot) {
+    FILE *saveFile;
+
+    saveFile = fopen(filePath, "ab");
+    if (saveFile) {
+        writeSnapshot(saveFile, theSnapshot);
+        fclose(saveFile);
+    }
+}
+
+// Restores the state appended by saveGame, if the file has one that this build can read.
+static boolean restoreSnapshotFromSavedGame() {
+    FILE *saveFile;
+    snapshot *theSnapshot = NULL;
+    boolean restored = false;
+
+    saveFile = fopen(currentFilePath, "rb");
+    if (saveFile) {
+        if (fseek(saveFile, lengthOfPlaybackFile, SEEK_SET) == 0) {
+            theSnapshot = readSnapshot(saveFile);
+        }
+        fclose(saveFile);
+    }
+
+    if (theSnapshot && theSnapshot->playerTurnNumber == rogue.howManyTurns) {
+        restored = restoreSnapshot(theSnapshot);
+        if (restored) {
+            recordingLocation = lengthOfPlaybackFile; // every event is accounted for
+        } else {
+            // Start over so the events can be replayed instead.
+            freeEverything();
+            randomNumbersGenerated = 0;
+            initializeRogue(0);
+        }
+    }
+    if (theSnapshot) {
+        freeSnapshot(theSnapshot);
+    }
+    return restored;
+}
+
 void saveGame() {
     char filePath[BROGUE_FILENAME_MAX], defaultPath[BROGUE_FILENAME_MAX];
     boolean askAgain;
+    snapshot *theSnapshot;
 
     if (rogue.playbackMode) {
         return; // Call me paranoid, but I'd rather it be impossible to embed malware in a recording.
     }
 
+    theSnapshot = captureSnapshot(NULL); // before the prompts below touch the message area
     getAvailableFilePath(defaultPath, "Saved game", GAME_SUFFIX);
 
     deleteMessages();
@@ -1109,6 +1228,9 @@ void saveGame() {
                 flushBufferToFile();
                 rename(currentFilePath, filePath);
                 strcpy(currentFilePath, filePath);
+                if (theSnapshot) {
+                    appendSnapshotToSavedGame(filePath, theSnapshot);
+                }
                 message("Saved.", true);
                 rogue.gameHasEnded = true;
             } else {
@@ -1117,6 +1239,9 @@ void saveGame() {
         }
     } while (askAgain);
     deleteMessages();
+    if (theSnapshot) {
+        freeSnapshot(theSnapshot);
+    }
 }
 
 void saveRecordingNoPrompt(char *filePath)
@@ -1196,6 +1321,7 @@ void switchToPlaying() {
     rogue.playbackFastForward   = false;
     rogue.playbackOmniscience   = false;
     locationInRecordingBuffer   = 0;
+    freeKeyframes();
     copyFile(currentFilePath, lastGamePath, recordingLocation);
 #ifndef ENABLE_PLAYBACK_SWITCH
     if (DELETE_SAVE_FILE_AFTER_LOADING) {
@@ -1216,6 +1342,7 @@ boolean loadSavedGame() {
     unsigned long progressBarInterval;
     unsigned long previousRecordingLocation;
     rogueEvent theEvent;
+    boolean restoredSnapshot = false;
 
     cellDisplayBuffer dbuf[COLS][ROWS];
 
@@ -1224,11 +1351,15 @@ boolean loadSavedGame() {
     rogue.playbackFastForward = true;
     initializeRogue(0); // Calls initRecording(). Seed argument is ignored because we're initially in playback mode.
     if (!rogue.gameHasEnded) {
+        // Replaying the recorded events is the fallback, for saves without a usable snapshot.
+        restoredSnapshot = restoreSnapshotFromSavedGame();
+    }
+    if (!rogue.gameHasEnded && !restoredSnapshot) {
         blackOutScreen();
         startLevel(rogue.depthLevel, 1);
     }
 
-    if (rogue.howManyTurns > 0) {
+    if (rogue.howManyTurns > 0 && !restoredSnapshot) {
 
         progressBarInterval = max(1, lengthOfPlaybackFile / 100);
         previousRecordingLocation = -1; // unsigned
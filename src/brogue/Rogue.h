@@ -80,6 +80,7 @@ strings, but they are equal (rogue.patchLevel is set to 0).
 
 //#define BROGUE_ASSERTS        // introduces several assert()s -- useful to find certain array overruns and other bugs
 //#define AUDIT_RNG             // VERY slow, but sometimes necessary to debug out-of-sync recording errors
+//#define VERIFY_TERRAIN_FLAGS  // checks the terrain flags cached in each cell against its layers whenever they're read
 //#define GENERATE_FONT_FILES   // Displays font in grid upon startup, which can be screen-captured into font files for PC.
 
 #ifdef BROGUE_ASSERTS
@@ -159,6 +160,7 @@ typedef long long fixpt;
 
 #define INPUT_RECORD_BUFFER     1000        // how many bytes of input data to keep in memory before saving it to disk
 #define DEFAULT_PLAYBACK_DELAY  50
+#define KEYFRAME_INTERVAL       1000        // how many turns apart playback keeps snapshots to seek from
 
 #define HIGH_SCORES_COUNT       30
 
@@ -1162,16 +1164,27 @@ enum tileFlags {
 #define max(x, y)       (((x) > (y)) ? (x) : (y))
 #define clamp(x, low, hi)   (min(hi, max(x, low))) // pins x to the [y, z] interval
 
-#define terrainFlags(x, y)                  (tileCatalog[pmap[x][y].layers[DUNGEON]].flags \
+#define layerTerrainFlags(x, y)             (tileCatalog[pmap[x][y].layers[DUNGEON]].flags \
                                             | tileCatalog[pmap[x][y].layers[LIQUID]].flags \
                                             | tileCatalog[pmap[x][y].layers[SURFACE]].flags \
                                             | tileCatalog[pmap[x][y].layers[GAS]].flags)
 
-#define terrainMechFlags(x, y)              (tileCatalog[pmap[x][y].layers[DUNGEON]].mechFlags \
+#define layerTerrainMechFlags(x, y)         (tileCatalog[pmap[x][y].layers[DUNGEON]].mechFlags \
                                             | tileCatalog[pmap[x][y].layers[LIQUID]].mechFlags \
                                             | tileCatalog[pmap[x][y].layers[SURFACE]].mechFlags \
                                             | tileCatalog[pmap[x][y].layers[GAS]].mechFlags)
 
+// Cached in each cell by refreshTerrainFlags(), which must follow any change to its layers.
+#ifdef VERIFY_TERRAIN_FLAGS
+unsigned long verifiedTerrainFlags(short x, short y);
+unsigned long verifiedTerrainMechFlags(short x, short y);
+#define terrainFlags(x, y)                  verifiedTerrainFlags((x), (y))
+#define terrainMechFlags(x, y)              verifiedTerrainMechFlags((x), (y))
+#else
+#define terrainFlags(x, y)                  (pmap[x][y].terrainFlags)
+#define terrainMechFlags(x, y)              (pmap[x][y].TMFlags)
+#endif
+
 #ifdef BROGUE_ASSERTS
 boolean cellHasTerrainFlag(short x, short y, unsigned long flagMask);
 #else
@@ -1184,7 +1197,7 @@ boolean cellHasTerrainFlag(short x, short y, unsigned long flagMask);
                                             || pmap[x][y].layers[SURFACE] == (terrain) \
                                             || pmap[x][y].layers[GAS] == (terrain)) ? true : false)
 
-#define cellHasKnownTerrainFlag(x, y, flagMask) ((flagMask) & pmap[(x)][(y)].rememberedTerrainFlags ? true : false)
+#define cellHasKnownTerrainFlag(x, y, flagMask) ((flagMask) & rmap[(x)][(y)].rememberedTerrainFlags ? true : false)
 
 #define cellIsPassableOrDoor(x, y)          (!cellHasTerrainFlag((x), (y), T_PATHING_BLOCKER) \
                                             || (cellHasTMFlag((x), (y), (TM_IS_SECRET | TM_PROMOTES_WITH_KEY | TM_CONNECTS_LEVEL)) \
@@ -1236,9 +1249,16 @@ typedef struct cellDisplayBuffer {
 
 typedef struct pcell {                              // permanent cell; have to remember this stuff to save levels
     enum tileType layers[NUMBER_TERRAIN_LAYERS];    // terrain
+    unsigned long terrainFlags;                     // terrain flags of all the layers combined
+    unsigned long TMFlags;                          // TM flags of all the layers combined
     unsigned long flags;                            // non-terrain cell flags
     unsigned short volume;                          // quantity of gas in cell
     unsigned char machineNumber;
+} pcell;
+
+typedef struct rcell {                              // remembered cell; what the player last saw of a permanent cell.
+                                                    // It is kept apart from pcell so that the loops over the whole map
+                                                    // don't drag it through the cache.
     cellDisplayBuffer rememberedAppearance;         // how the player remembers the cell to look
     enum itemCategory rememberedItemCategory;       // what category of item the player remembers lying there
     short rememberedItemKind;                       // what kind of item the player remembers lying there
@@ -1248,7 +1268,12 @@ typedef struct pcell {                              // permanent cell; have to r
     unsigned long rememberedCellFlags;              // map cell flags the player remembers from that spot
     unsigned long rememberedTerrainFlags;           // terrain flags the player remembers from that spot
     unsigned long rememberedTMFlags;                // TM flags the player remembers from that spot
-} pcell;
+} rcell;
+
+typedef struct storedCell {     // a cell of a level the player is not on
+    pcell cell;
+    rcell remembered;
+} storedCell;
 
 typedef struct tcell {          // transient cell; stuff we don't need to remember between levels
     short light[3];             // RGB components of lighting
@@ -2331,7 +2356,7 @@ typedef struct playerCharacter {
 // Stores the necessary info about a level so it can be regenerated:
 typedef struct levelData {
     boolean visited;
-    pcell mapStorage[DCOLS][DROWS];
+    storedCell mapStorage[DCOLS][DROWS];
     struct item *items;
     struct creature *monsters;
     struct creature *dormantMonsters;
@@ -2343,6 +2368,17 @@ typedef struct levelData {
     unsigned long awaySince;
 } levelData;
 
+// A copy of the entire game state, used to seek within recordings and to load saved games
+// without replaying them from the start.
+typedef struct snapshot {
+    unsigned long playerTurnNumber;
+    unsigned long recordingLocation;        // how far into the recording the game had read
+    unsigned char *state;                   // everything except the stored maps of the levels
+    unsigned long stateLength;
+    storedCell *levelMaps[DEEPEST_LEVEL+1];      // levels[i].mapStorage for each visited level, else NULL
+    boolean ownsLevelMap[DEEPEST_LEVEL+1];  // false if the map is shared with an earlier snapshot
+} snapshot;
+
 enum machineFeatureFlags {
     MF_GENERATE_ITEM                = Fl(0),    // feature entails generating an item (overridden if the machine is adopting an item)
     MF_OUTSOURCE_ITEM_TO_MACHINE    = Fl(1),    // item must be adopted by another machine
@@ -2622,6 +2658,8 @@ extern "C" {
     uint64_t rand_64bits();
     long rand_range(long lowerBound, long upperBound);
     uint64_t seedRandomGenerator(uint64_t seed);
+    void getRNGState(uint32_t state[NUMBER_OF_RNGS][4]);
+    void setRNGState(uint32_t state[NUMBER_OF_RNGS][4]);
     short randClumpedRange(short lowerBound, short upperBound, short clumpFactor);
     short randClump(randomRange theRange);
     boolean rand_percent(short percent);
@@ -2654,6 +2692,7 @@ extern "C" {
                           item *parentSpawnedItems[50],
                           creature *parentSpawnedMonsters[50]);
     void attachRooms(short **grid, const dungeonProfile *theDP, short attempts, short maxRoomCount);
+    void refreshTerrainFlags(short x, short y);
     void digDungeon();
     void updateMapToShore();
     short levelIsDisconnectedWithBlockingMap(char blockingMap[DCOLS][DROWS], boolean countRegionSize);
@@ -2667,6 +2706,7 @@ extern "C" {
     boolean spawnDungeonFeature(short x, short y, dungeonFeature *feat, boolean refreshCell, boolean abortIfBlocking);
     void restoreMonster(creature *monst, short **mapToStairs, short **mapToPit);
     void restoreItem(item *theItem);
+    void forgetWaypointCosts();
     void refreshWaypoint(short wpIndex);
     void setUpWaypoints();
     void zeroOutGrid(char grid[DCOLS][DROWS]);
@@ -2688,6 +2728,7 @@ extern "C" {
     boolean saveHighScore(rogueHighScoresEntry theEntry);
     fileEntry *listFiles(short *fileCount, char **dynamicMemoryBuffer);
     void initializeLaunchArguments(enum NGCommands *command, char *path, uint64_t *seed);
+    boolean scanSeedCatalogInParallel(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth, boolean isCsvFormat, int jobs);
 
     char nextKeyPress(boolean textInput);
     void refreshSideBar(short focusX, short focusY, boolean focusedEntityMustGoFirst);
@@ -2775,6 +2816,7 @@ extern "C" {
     void freeCreature(creature *monst);
     void emptyGraveyard();
     void freeEverything();
+    void updateColors();
     boolean randomMatchingLocation(short *x, short *y, short dungeonType, short liquidType, short terrainType);
     enum dungeonLayers highestPriorityLayer(short x, short y, boolean skipGas);
     enum dungeonLayers layerWithTMFlag(short x, short y, unsigned long flag);
@@ -2806,6 +2848,8 @@ extern "C" {
                             boolean canUseSecretDoors,
                             boolean eightWays);
     short pathingDistance(short x1, short y1, short x2, short y2, unsigned long blockingTerrainFlags);
+    void shareDownhillSteps(short **distanceMap);
+    void forgetDownhillSteps();
     short nextStep(short **distanceMap, short x, short y, creature *monst, boolean reverseDirections);
     void travelRoute(short path[1000][2], short steps);
     void travel(short x, short y, boolean autoConfirm);
@@ -2831,6 +2875,9 @@ extern "C" {
     boolean exposeTileToFire(short x, short y, boolean alwaysIgnite);
     boolean cellCanHoldGas(short x, short y);
     void monstersFall();
+    void updateVolumetricMedia();
+    void noteEnvironmentChangeAt(short x, short y);
+    void findActiveEnvironmentCells();
     void updateEnvironment();
     void updateAllySafetyMap();
     void updateSafetyMap();
@@ -2871,9 +2918,6 @@ extern "C" {
 
     void getFOVMask(char grid[DCOLS][DROWS], short xLoc, short yLoc, fixpt maxRadius,
                     unsigned long forbiddenTerrain, unsigned long forbiddenFlags, boolean cautiousOnWalls);
-    void scanOctantFOV(char grid[DCOLS][DROWS], short xLoc, short yLoc, short octant, fixpt maxRadius,
-                       short columnsRightFromOrigin, long startSlope, long endSlope, unsigned long forbiddenTerrain,
-                       unsigned long forbiddenFlags, boolean cautiousOnWalls);
 
     creature *generateMonster(short monsterID, boolean itemPossible, boolean mutationPossible);
     short chooseMonster(short forLevel);
@@ -2899,6 +2943,8 @@ extern "C" {
                                  unsigned long blockingTerrain, unsigned long blockingFlags);
     boolean traversiblePathBetween(creature *monst, short x2, short y2);
     boolean openPathBetween(short x1, short y1, short x2, short y2);
+    void forgetMonsterLocations();
+    void forgetMonsterLocation(creature *monst);
     creature *monsterAtLoc(short x, short y);
     creature *dormantMonsterAtLoc(short x, short y);
     void perimeterCoords(short returnCoords[2], short n);
@@ -3095,6 +3141,7 @@ extern "C" {
     void unequipItem(item *theItem, boolean force);
     short magicCharDiscoverySuffix(short category, short kind);
     int itemMagicPolarity(item *theItem);
+    void forgetItemLocations();
     item *itemAtLoc(short x, short y);
     item *dropItem(item *theItem);
     itemTable *tableForItemCategory(enum itemCategory theCat, short *kindCount);
@@ -3115,6 +3162,7 @@ extern "C" {
     void backUpLighting(short lights[DCOLS][DROWS][3]);
     void restoreLighting(short lights[DCOLS][DROWS][3]);
     void updateLighting();
+    void forgetStaticLights();
     boolean playerInDarkness();
     flare *newFlare(lightSource *light, short x, short y, short changePerFrame, short limit);
     void createFlare(short x, short y, enum lightType lightIndex);
@@ -3148,6 +3196,8 @@ extern "C" {
     void OOSCheck(unsigned long x, short numberOfBytes);
     void RNGCheck();
     boolean executePlaybackInput(rogueEvent *recordingInput);
+    void considerCapturingKeyframe();
+    void freeKeyframes();
     void getAvailableFilePath(char *filePath, const char *defaultPath, const char *suffix);
     boolean characterForbiddenInFilename(const char theChar);
     void saveGame();
@@ -3156,6 +3206,12 @@ extern "C" {
     void parseFile();
     void RNGLog(char *message);
 
+    snapshot *captureSnapshot(const snapshot *previous);
+    boolean restoreSnapshot(const snapshot *theSnapshot);
+    void freeSnapshot(snapshot *theSnapshot);
+    void writeSnapshot(FILE *file, const snapshot *theSnapshot);
+    snapshot *readSnapshot(FILE *file);
+
     short wandDominate(creature *monst);
     short staffDamageLow(fixpt enchant);
     short staffDamageHigh(fixpt enchant);
@@ -3193,7 +3249,9 @@ extern "C" {
     boolean dialogChooseFile(char *path, const char *suffix, const char *prompt);
     void dialogAlert(char *message);
     void mainBrogueJunction();
-    void printSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth, boolean isCsvFormat);
+    void printSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth, boolean isCsvFormat, int jobs);
+    void scanSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth, boolean isCsvFormat, const char *scratchName);
+    boolean runBenchmarks(const char *jsonPath);
 
     void initializeButton(brogueButton *button);
     void drawButtonsInState(buttonState *state);
@@ -3216,6 +3274,9 @@ extern "C" {
                           rogueEvent *returnEvent);
 
     void dijkstraScan(short **distanceMap, short **costMap, boolean useDiagonals);
+    void noteTerrainChange();
+    void forgetCachedDistances();
+    void dijkstraRepair(short **distanceMap, short **oldCostMap, short **costMap, boolean useDiagonals);
     void pdsClear(pdsMap *map, short maxDistance, boolean eightWays);
     void pdsSetDistance(pdsMap *map, short x, short y, short distance);
     void pdsBatchOutput(pdsMap *map, short **distanceMap);
@@ -585,6 +585,8 @@ void startLevel(short oldLevelNumber, short stairDirection) {
     levels[oldLevelNumber-1].monsters = monsters->nextCreature;
     levels[oldLevelNumber-1].dormantMonsters = dormantMonsters->nextCreature;
     levels[oldLevelNumber-1].items = floorItems->nextItem;
+    forgetMonsterLocations();
+    forgetItemLocations();
 
     for (i=0; i<DCOLS; i++) {
         for (j=0; j<DROWS; j++) {
@@ -593,20 +595,12 @@ void startLevel(short oldLevelNumber, short stairDirection) {
                 storeMemories(i, j);
             }
             for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
-                levels[oldLevelNumber - 1].mapStorage[i][j].layers[layer] = pmap[i][j].layers[layer];
+                levels[oldLevelNumber - 1].mapStorage[i][j].cell.layers[layer] = pmap[i][j].layers[layer];
             }
-            levels[oldLevelNumber - 1].mapStorage[i][j].volume = pmap[i][j].volume;
-            levels[oldLevelNumber - 1].mapStorage[i][j].flags = (pmap[i][j].flags & PERMANENT_TILE_FLAGS);
-            levels[oldLevelNumber - 1].mapStorage[i][j].machineNumber = pmap[i][j].machineNumber;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedAppearance = pmap[i][j].rememberedAppearance;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedItemCategory = pmap[i][j].rememberedItemCategory;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedItemKind = pmap[i][j].rememberedItemKind;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedItemQuantity = pmap[i][j].rememberedItemQuantity;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedItemOriginDepth = pmap[i][j].rememberedItemOriginDepth;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedTerrain = pmap[i][j].rememberedTerrain;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedCellFlags = pmap[i][j].rememberedCellFlags;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedTerrainFlags = pmap[i][j].rememberedTerrainFlags;
-            levels[oldLevelNumber - 1].mapStorage[i][j].rememberedTMFlags = pmap[i][j].rememberedTMFlags;
+            levels[oldLevelNumber - 1].mapStorage[i][j].cell.volume = pmap[i][j].volume;
+            levels[oldLevelNumber - 1].mapStorage[i][j].cell.flags = (pmap[i][j].flags & PERMANENT_TILE_FLAGS);
+            levels[oldLevelNumber - 1].mapStorage[i][j].cell.machineNumber = pmap[i][j].machineNumber;
+            levels[oldLevelNumber - 1].mapStorage[i][j].remembered = rmap[i][j];
         }
     }
 
@@ -691,20 +685,13 @@ void startLevel(short oldLevelNumber, short stairDirection) {
         for (i=0; i<DCOLS; i++) {
             for (j=0; j<DROWS; j++) {
                 for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
-                    pmap[i][j].layers[layer] = levels[rogue.depthLevel - 1].mapStorage[i][j].layers[layer];
+                    pmap[i][j].layers[layer] = levels[rogue.depthLevel - 1].mapStorage[i][j].cell.layers[layer];
                 }
-                pmap[i][j].volume = levels[rogue.depthLevel - 1].mapStorage[i][j].volume;
-                pmap[i][j].flags = (levels[rogue.depthLevel - 1].mapStorage[i][j].flags & PERMANENT_TILE_FLAGS);
-                pmap[i][j].machineNumber = levels[rogue.depthLevel - 1].mapStorage[i][j].machineNumber;
-                pmap[i][j].rememberedAppearance = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedAppearance;
-                pmap[i][j].rememberedItemCategory = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedItemCategory;
-                pmap[i][j].rememberedItemKind = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedItemKind;
-                pmap[i][j].rememberedItemQuantity = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedItemQuantity;
-                pmap[i][j].rememberedItemOriginDepth = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedItemOriginDepth;
-                pmap[i][j].rememberedTerrain = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedTerrain;
-                pmap[i][j].rememberedCellFlags = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedCellFlags;
-                pmap[i][j].rememberedTerrainFlags = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedTerrainFlags;
-                pmap[i][j].rememberedTMFlags = levels[rogue.depthLevel - 1].mapStorage[i][j].rememberedTMFlags;
+                refreshTerrainFlags(i, j);
+                pmap[i][j].volume = levels[rogue.depthLevel - 1].mapStorage[i][j].cell.volume;
+                pmap[i][j].flags = (levels[rogue.depthLevel - 1].mapStorage[i][j].cell.flags & PERMANENT_TILE_FLAGS);
+                pmap[i][j].machineNumber = levels[rogue.depthLevel - 1].mapStorage[i][j].cell.machineNumber;
+                rmap[i][j] = levels[rogue.depthLevel - 1].mapStorage[i][j].remembered;
             }
         }
 
@@ -735,6 +722,7 @@ void startLevel(short oldLevelNumber, short stairDirection) {
     px = player.xLoc;
     py = player.yLoc;
     player.xLoc = player.yLoc = 0;
+    findActiveEnvironmentCells();
     for (i = 0; i < 100 && i < (short) timeAway; i++) {
         updateEnvironment();
     }
@@ -906,6 +894,11 @@ void freeEverything() {
         }
     }
     scentMap = NULL;
+    forgetMonsterLocations();
+    forgetItemLocations();
+    forgetWaypointCosts();
+    forgetCachedDistances();
+    forgetStaticLights();
     for (monst = monsters; monst != NULL; monst = monst2) {
         monst2 = monst->nextCreature;
         freeCreature(monst);
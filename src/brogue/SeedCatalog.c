@@ -250,30 +250,17 @@ static void printSeedCatalogAltars(boolean isCsvFormat) {
     }
 }
 
-void printSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth,
-                      boolean isCsvFormat) {
+// Scans the given seeds, printing the catalog entries for each. The game writes a recording while it builds the
+// levels; scratchName names that file (without suffix), which is deleted after each seed.
+void scanSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth,
+                     boolean isCsvFormat, const char *scratchName) {
     uint64_t theSeed;
     char path[BROGUE_FILENAME_MAX];
-    char message[1000] = "";
     rogue.nextGame = NG_NOTHING;
 
-    getAvailableFilePath(path, LAST_GAME_NAME, GAME_SUFFIX);
+    getAvailableFilePath(path, scratchName, GAME_SUFFIX);
     strcat(path, GAME_SUFFIX);
 
-    sprintf(message, "Brogue seed catalog, seeds %llu to %llu, through depth %u.\n"
-                     "Generated with %s. Dungeons unchanged since %s.\n\n"
-                     "To play one of these seeds, press control-N from the title screen"
-                     " and enter the seed number.\n",
-            startingSeed, startingSeed + numberOfSeedsToScan - 1, scanThroughDepth, BROGUE_VERSION_STRING,
-            BROGUE_DUNGEON_VERSION_STRING, scanThroughDepth);
-
-    if (isCsvFormat) {
-        fprintf(stderr, "%s", message);
-        printf("%s\n",CSV_HEADER_STRING);
-    } else {
-        printf("%s", message);
-    }
-
     for (theSeed = startingSeed; theSeed < startingSeed + numberOfSeedsToScan; theSeed++) {
         if (!isCsvFormat) {
             printf("Seed %llu:\n", theSeed);
@@ -306,5 +293,31 @@ void printSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsig
         freeEverything();
         remove(currentFilePath); // Don't add a spurious LastGame file to the brogue folder.
     }
+}
 
+// With jobs > 1, the seeds are split between that many worker processes where the platform supports it.
+// The output is the same either way.
+void printSeedCatalog(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth,
+                      boolean isCsvFormat, int jobs) {
+    char message[1000] = "";
+
+    sprintf(message, "Brogue seed catalog, seeds %llu to %llu, through depth %u.\n"
+                     "Generated with %s. Dungeons unchanged since %s.\n\n"
+                     "To play one of these seeds, press control-N from the title screen"
+                     " and enter the seed number.\n",
+            startingSeed, startingSeed + numberOfSeedsToScan - 1, scanThroughDepth, BROGUE_VERSION_STRING,
+            BROGUE_DUNGEON_VERSION_STRING, scanThroughDepth);
+
+    if (isCsvFormat) {
+        fprintf(stderr, "%s", message);
+        printf("%s\n",CSV_HEADER_STRING);
+    } else {
+        printf("%s", message);
+    }
+
+    if (jobs > 1 && numberOfSeedsToScan > 1
+        && scanSeedCatalogInParallel(startingSeed, numberOfSeedsToScan, scanThroughDepth, isCsvFormat, jobs)) {
+        return;
+    }
+    scanSeedCatalog(startingSeed, numberOfSeedsToScan, scanThroughDepth, isCsvFormat, LAST_GAME_NAME);
 }
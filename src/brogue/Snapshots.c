@@ -0,0 +1,931 @@
+/*
+ *  Snapshots.c
+ *  Brogue
+ *
+ *  Copyright 2012. All rights reserved.
+ *
+ *  This file is part of Brogue.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Rogue.h"
+#include "IncludeGlobals.h"
+
+/*
+A snapshot holds everything that replaying a recording would otherwise have to
+rebuild: the RNGs, the maps, the levels, every creature and item, and rogue.
+Records are copied byte for byte with their pointers cleared; each pointer is
+written separately as an index into the creatures and items in the order they
+were written, or into a table of the static colors and lights that creatures,
+items and flares point at. Restoring reads everything back in the same order.
+
+The flavor names of items depend only on the seed and are not saved; a snapshot
+may only be restored into the game (or a fresh initialization of the game) it
+was captured from.
+*/
+
+// Changes to any of these make old snapshots unreadable.
+static const unsigned long snapshotLayout[] = {
+    0x01020304, // byte order
+    sizeof(long), sizeof(void *),
+    sizeof(playerCharacter), sizeof(creature), sizeof(item), sizeof(pcell), sizeof(rcell), sizeof(tcell), sizeof(flare),
+    DCOLS, DROWS, DEEPEST_LEVEL, MAX_WAYPOINT_COUNT, MESSAGE_ARCHIVE_LINES,
+    NUMBER_MONSTER_KINDS, NUMBER_LIGHT_KINDS, NUMBER_DUNGEON_FEATURES,
+};
+
+// Colors that are assigned by address outside of the monster and light catalogs.
+static const color *const otherColors[] = {
+    &white, &gray, &itemColor, &spectralImageColor, &fireForeColor, &torchLightColor, &minersLightColor,
+    &playerInvisibleColor, &playerInDarknessColor, &playerInShadowColor, &playerInLightColor,
+};
+
+#define NUMBER_OF_SNAPSHOT_COLORS   (NUMBER_MONSTER_KINDS + NUMBER_LIGHT_KINDS + sizeof(otherColors) / sizeof(*otherColors))
+
+typedef struct snapshotBuffer {
+    unsigned char *data;
+    unsigned long length;
+    unsigned long capacity;
+    unsigned long position;
+    boolean failed;
+} snapshotBuffer;
+
+typedef struct pointerList {
+    void **pointers;
+    int count;
+    int capacity;
+} pointerList;
+
+static void writeBytes(snapshotBuffer *buf, const void *source, unsigned long length) {
+    if (buf->length + length > buf->capacity) {
+        buf->capacity = max(buf->capacity * 2, buf->length + length);
+        buf->data = realloc(buf->data, buf->capacity);
+    }
+    memcpy(buf->data + buf->length, source, length);
+    buf->length += length;
+}
+
+static void readBytes(snapshotBuffer *buf, void *destination, unsigned long length) {
+    if (buf->failed || buf->position + length > buf->length) {
+        buf->failed = true;
+        memset(destination, 0, length);
+        return;
+    }
+    memcpy(destination, buf->data + buf->position, length);
+    buf->position += length;
+}
+
+static void writeInt(snapshotBuffer *buf, int n) {
+    writeBytes(buf, &n, sizeof(int));
+}
+
+static int readInt(snapshotBuffer *buf) {
+    int n;
+    readBytes(buf, &n, sizeof(int));
+    return n;
+}
+
+static void addPointer(pointerList *list, void *pointer) {
+    if (list->count >= list->capacity) {
+        list->capacity = max(64, list->capacity * 2);
+        list->pointers = realloc(list->pointers, sizeof(void *) * list->capacity);
+    }
+    list->pointers[list->count++] = pointer;
+}
+
+// -1 for NULL, and for anything that isn't in the list.
+static int pointerIndex(const pointerList *list, const void *pointer) {
+    int i;
+
+    if (pointer != NULL) {
+        for (i = 0; i < list->count; i++) {
+            if (list->pointers[i] == pointer) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static void *pointerAtIndex(snapshotBuffer *buf, const pointerList *list, int index) {
+    if (index < -1 || index >= list->count) {
+        buf->failed = true;
+        return NULL;
+    }
+    return (index == -1 ? NULL : list->pointers[index]);
+}
+
+// A saved game can come from anywhere, and its records are copied in byte for byte, so every count,
+// index and location in them is checked before the game can use one. Anything out of range fails
+// the restore, and loadSavedGame replays the recorded events instead.
+static void checkRange(snapshotBuffer *buf, long value, long low, long high) {
+    if (value < low || value > high) {
+        buf->failed = true;
+    }
+}
+
+static void checkLocation(snapshotBuffer *buf, short x, short y) {
+    if (!coordinatesAreInMap(x, y)) {
+        buf->failed = true;
+    }
+}
+
+// For the locations that are set to -1 when there is nothing there.
+static void checkOptionalLocation(snapshotBuffer *buf, short x, short y) {
+    if (x != -1 || y != -1) {
+        checkLocation(buf, x, y);
+    }
+}
+
+static void checkString(snapshotBuffer *buf, const char *string, unsigned long size) {
+    if (!memchr(string, '\0', size)) {
+        buf->failed = true;
+    }
+}
+
+// A category of 0 is allowed for the remembered items of cells that have none.
+static void checkItemKind(snapshotBuffer *buf, unsigned short category, short kind) {
+    short kindCount;
+
+    if (category == 0) {
+        return;
+    }
+    if (category & (category - 1) || !(category & ALL_ITEMS)) {
+        buf->failed = true; // not exactly one category
+    } else if (category == KEY) {
+        checkRange(buf, kind, 0, NUMBER_KEY_TYPES - 1);
+    } else if (tableForItemCategory(category, &kindCount)) {
+        checkRange(buf, kind, 0, kindCount - 1);
+    }
+}
+
+static void checkCell(snapshotBuffer *buf, const pcell *cell) {
+    short layer;
+
+    for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
+        checkRange(buf, cell->layers[layer], 0, NUMBER_TILETYPES - 1);
+    }
+}
+
+static void checkRememberedCell(snapshotBuffer *buf, const rcell *remembered) {
+    checkRange(buf, remembered->rememberedTerrain, 0, NUMBER_TILETYPES - 1);
+    checkItemKind(buf, remembered->rememberedItemCategory, remembered->rememberedItemKind);
+}
+
+static void checkItem(snapshotBuffer *buf, const item *theItem) {
+    short i;
+
+    checkItemKind(buf, theItem->category, theItem->kind);
+    checkRange(buf, theItem->category, 1, ALL_ITEMS); // an item always has a category
+    if ((theItem->category & WEAPON) && (theItem->flags & ITEM_RUNIC)) {
+        checkRange(buf, theItem->enchant2, 0, NUMBER_WEAPON_RUNIC_KINDS - 1);
+    }
+    if ((theItem->category & ARMOR) && (theItem->flags & ITEM_RUNIC)) {
+        checkRange(buf, theItem->enchant2, 0, NUMBER_ARMOR_ENCHANT_KINDS - 1);
+    }
+    checkRange(buf, theItem->vorpalEnemy, 0, MONSTER_CLASS_COUNT - 1);
+    checkRange(buf, theItem->originDepth, 0, DEEPEST_LEVEL);
+    checkString(buf, theItem->inscription, sizeof(theItem->inscription));
+    for (i = 0; i < KEY_ID_MAXIMUM; i++) {
+        if (theItem->keyLoc[i].x || theItem->keyLoc[i].y) {
+            checkLocation(buf, theItem->keyLoc[i].x, theItem->keyLoc[i].y);
+        }
+    }
+}
+
+static void checkCreature(snapshotBuffer *buf, const creature *monst) {
+    short i;
+
+    checkRange(buf, monst->info.monsterID, 0, NUMBER_MONSTER_KINDS - 1);
+    checkString(buf, monst->info.monsterName, sizeof(monst->info.monsterName));
+    checkRange(buf, monst->info.bloodType, 0, NUMBER_DUNGEON_FEATURES - 1);
+    checkRange(buf, monst->info.DFType, 0, NUMBER_DUNGEON_FEATURES - 1);
+    checkRange(buf, monst->info.intrinsicLightType, 0, NUMBER_LIGHT_KINDS - 1);
+    for (i = 0; i < 20; i++) {
+        checkRange(buf, monst->info.bolts[i], 0, NUMBER_BOLT_KINDS - 1);
+    }
+    checkRange(buf, monst->info.bolts[19], BOLT_NONE, BOLT_NONE); // the list is read up to its BOLT_NONE
+    checkRange(buf, monst->absorptionBolt, 0, NUMBER_BOLT_KINDS - 1);
+    checkString(buf, monst->targetCorpseName, sizeof(monst->targetCorpseName));
+    checkLocation(buf, monst->xLoc, monst->yLoc);
+    checkRange(buf, monst->depth, 0, DEEPEST_LEVEL);
+    checkRange(buf, monst->mutationIndex, -1, NUMBER_MUTATORS - 1);
+    checkRange(buf, monst->targetWaypointIndex, -1, MAX_WAYPOINT_COUNT - 1);
+}
+
+static void writeColor(snapshotBuffer *buf, const color *theColor) {
+    int i, index = -1;
+
+    if (theColor != NULL) {
+        for (i = 0; i < NUMBER_MONSTER_KINDS && index == -1; i++) {
+            if (monsterCatalog[i].foreColor == theColor) {
+                index = i;
+            }
+        }
+        for (i = 0; i < NUMBER_LIGHT_KINDS && index == -1; i++) {
+            if (lightCatalog[i].lightColor == theColor) {
+                index = NUMBER_MONSTER_KINDS + i;
+            }
+        }
+        for (i = 0; i < (int) (sizeof(otherColors) / sizeof(*otherColors)) && index == -1; i++) {
+            if (otherColors[i] == theColor) {
+                index = NUMBER_MONSTER_KINDS + NUMBER_LIGHT_KINDS + i;
+            }
+        }
+        if (index == -1) {
+            buf->failed = true; // a color we don't know how to find again
+        }
+    }
+    writeInt(buf, index);
+}
+
+static const color *readColor(snapshotBuffer *buf) {
+    const int index = readInt(buf);
+
+    if (index == -1) {
+        return NULL;
+    } else if (index < 0 || index >= (int) NUMBER_OF_SNAPSHOT_COLORS) {
+        buf->failed = true;
+        return NULL;
+    } else if (index < NUMBER_MONSTER_KINDS) {
+        return monsterCatalog[index].foreColor;
+    } else if (index < NUMBER_MONSTER_KINDS + NUMBER_LIGHT_KINDS) {
+        return lightCatalog[index - NUMBER_MONSTER_KINDS].lightColor;
+    } else {
+        return otherColors[index - NUMBER_MONSTER_KINDS - NUMBER_LIGHT_KINDS];
+    }
+}
+
+static void writeGrid(snapshotBuffer *buf, short **grid) {
+    const boolean present = (grid != NULL);
+
+    writeBytes(buf, &present, sizeof(boolean));
+    if (present) {
+        writeBytes(buf, grid[0], sizeof(short) * DCOLS * DROWS);
+    }
+}
+
+static short **readGrid(snapshotBuffer *buf) {
+    boolean present;
+    short **grid = NULL;
+
+    readBytes(buf, &present, sizeof(boolean));
+    if (present) {
+        grid = allocGrid();
+        readBytes(buf, grid[0], sizeof(short) * DCOLS * DROWS);
+    }
+    return grid;
+}
+
+static void writeItem(snapshotBuffer *buf, item *theItem, pointerList *items) {
+    item copy = *theItem;
+
+    addPointer(items, theItem);
+    copy.foreColor = NULL;
+    copy.inventoryColor = NULL;
+    copy.nextItem = NULL;
+    writeBytes(buf, &copy, sizeof(item));
+    writeColor(buf, theItem->foreColor);
+    writeColor(buf, theItem->inventoryColor);
+}
+
+static item *readItem(snapshotBuffer *buf, pointerList *items) {
+    item *theItem = malloc(sizeof(item));
+
+    readBytes(buf, theItem, sizeof(item));
+    theItem->nextItem = NULL;
+    checkItem(buf, theItem);
+    theItem->foreColor = (color *) readColor(buf);
+    theItem->inventoryColor = (color *) readColor(buf);
+    addPointer(items, theItem);
+    return theItem;
+}
+
+static void writeItemChain(snapshotBuffer *buf, item *first, pointerList *items) {
+    item *theItem;
+    int count = 0;
+
+    for (theItem = first; theItem != NULL; theItem = theItem->nextItem) {
+        count++;
+    }
+    writeInt(buf, count);
+    for (theItem = first; theItem != NULL; theItem = theItem->nextItem) {
+        writeItem(buf, theItem, items);
+    }
+}
+
+static item *readItemChain(snapshotBuffer *buf, pointerList *items) {
+    item *first = NULL, **link = &first;
+    int i, count = readInt(buf);
+
+    for (i = 0; i < count && !buf->failed; i++) {
+        *link = readItem(buf, items);
+        link = &((*link)->nextItem);
+    }
+    return first;
+}
+
+static item *newItemChainHead() {
+    item *head = malloc(sizeof(item));
+    memset(head, '\0', sizeof(item));
+    return head;
+}
+
+static creature *newCreatureChainHead() {
+    creature *head = malloc(sizeof(creature));
+    memset(head, '\0', sizeof(creature));
+    return head;
+}
+
+// Creatures are numbered before anything is written, since leaders can come after their followers.
+static void listCreature(pointerList *creatures, creature *monst) {
+    for (; monst != NULL; monst = monst->carriedMonster) {
+        addPointer(creatures, monst);
+    }
+}
+
+static void listCreatureChain(pointerList *creatures, creature *first) {
+    creature *monst;
+
+    for (monst = first; monst != NULL; monst = monst->nextCreature) {
+        listCreature(creatures, monst);
+    }
+}
+
+static void listAllCreatures(pointerList *creatures) {
+    short i;
+
+    listCreature(creatures, &player);
+    listCreatureChain(creatures, monsters->nextCreature);
+    listCreatureChain(creatures, dormantMonsters->nextCreature);
+    listCreatureChain(creatures, graveyard->nextCreature);
+    listCreatureChain(creatures, purgatory->nextCreature);
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        listCreatureChain(creatures, levels[i].monsters);
+        listCreatureChain(creatures, levels[i].dormantMonsters);
+    }
+}
+
+static void writeCreature(snapshotBuffer *buf, creature *monst, const pointerList *creatures, pointerList *items) {
+    creature copy = *monst;
+
+    copy.info.foreColor = NULL;
+    copy.mapToMe = NULL;
+    copy.safetyMap = NULL;
+    copy.leader = NULL;
+    copy.carriedMonster = NULL;
+    copy.nextCreature = NULL;
+    copy.carriedItem = NULL;
+    writeBytes(buf, &copy, sizeof(creature));
+    writeColor(buf, monst->info.foreColor);
+    writeGrid(buf, monst->mapToMe);
+    writeGrid(buf, monst->safetyMap);
+    writeInt(buf, pointerIndex(creatures, monst->leader));
+    writeInt(buf, monst->carriedItem != NULL);
+    if (monst->carriedItem) {
+        writeItem(buf, monst->carriedItem, items);
+    }
+    writeInt(buf, monst->carriedMonster != NULL);
+    if (monst->carriedMonster) {
+        writeCreature(buf, monst->carriedMonster, creatures, items);
+    }
+}
+
+// Leaders are resolved once every creature exists; until then leaderIndices holds them.
+static creature *readCreature(snapshotBuffer *buf, creature *into, pointerList *creatures, pointerList *leaderIndices, pointerList *items) {
+    creature *monst = (into ? into : malloc(sizeof(creature)));
+
+    readBytes(buf, monst, sizeof(creature));
+    monst->leader = NULL;
+    monst->carriedMonster = NULL;
+    monst->nextCreature = NULL;
+    monst->carriedItem = NULL;
+    checkCreature(buf, monst);
+    monst->info.foreColor = readColor(buf);
+    monst->mapToMe = readGrid(buf);
+    monst->safetyMap = readGrid(buf);
+    addPointer(creatures, monst);
+    addPointer(leaderIndices, (void *) (intptr_t) readInt(buf));
+    if (readInt(buf)) {
+        monst->carriedItem = readItem(buf, items);
+    }
+    if (readInt(buf) && !buf->failed) {
+        monst->carriedMonster = readCreature(buf, NULL, creatures, leaderIndices, items);
+    }
+    return monst;
+}
+
+static void writeCreatureChain(snapshotBuffer *buf, creature *first, const pointerList *creatures, pointerList *items) {
+    creature *monst;
+    int count = 0;
+
+    for (monst = first; monst != NULL; monst = monst->nextCreature) {
+        count++;
+    }
+    writeInt(buf, count);
+    for (monst = first; monst != NULL; monst = monst->nextCreature) {
+        writeCreature(buf, monst, creatures, items);
+    }
+}
+
+static creature *readCreatureChain(snapshotBuffer *buf, pointerList *creatures, pointerList *leaderIndices, pointerList *items) {
+    creature *first = NULL, **link = &first;
+    int i, count = readInt(buf);
+
+    for (i = 0; i < count && !buf->failed; i++) {
+        *link = readCreature(buf, NULL, creatures, leaderIndices, items);
+        link = &((*link)->nextCreature);
+    }
+    return first;
+}
+
+static itemTable *const mutableItemTables[] = {scrollTable, potionTable, wandTable, staffTable, ringTable, charmTable};
+static const short mutableItemTableSizes[] = {NUMBER_SCROLL_KINDS, NUMBER_POTION_KINDS, NUMBER_WAND_KINDS,
+    NUMBER_STAFF_KINDS, NUMBER_RING_KINDS, NUMBER_CHARM_KINDS};
+
+// What the player has learned about each kind of item, and how often the metered kinds spawn.
+static void writeItemKnowledge(snapshotBuffer *buf) {
+    short i, j;
+
+    for (i = 0; i < (short) (sizeof(mutableItemTables) / sizeof(*mutableItemTables)); i++) {
+        for (j = 0; j < mutableItemTableSizes[i]; j++) {
+            writeBytes(buf, mutableItemTables[i][j].callTitle, sizeof(mutableItemTables[i][j].callTitle));
+            writeBytes(buf, &mutableItemTables[i][j].frequency, sizeof(short));
+            writeBytes(buf, &mutableItemTables[i][j].identified, sizeof(boolean));
+            writeBytes(buf, &mutableItemTables[i][j].called, sizeof(boolean));
+        }
+    }
+    for (i = 0; i < NUMBER_DUNGEON_FEATURES; i++) {
+        writeBytes(buf, &dungeonFeatureCatalog[i].messageDisplayed, sizeof(boolean));
+    }
+}
+
+static void readItemKnowledge(snapshotBuffer *buf) {
+    short i, j;
+
+    for (i = 0; i < (short) (sizeof(mutableItemTables) / sizeof(*mutableItemTables)); i++) {
+        for (j = 0; j < mutableItemTableSizes[i]; j++) {
+            readBytes(buf, mutableItemTables[i][j].callTitle, sizeof(mutableItemTables[i][j].callTitle));
+            readBytes(buf, &mutableItemTables[i][j].frequency, sizeof(short));
+            readBytes(buf, &mutableItemTables[i][j].identified, sizeof(boolean));
+            readBytes(buf, &mutableItemTables[i][j].called, sizeof(boolean));
+            checkString(buf, mutableItemTables[i][j].callTitle, sizeof(mutableItemTables[i][j].callTitle));
+        }
+    }
+    for (i = 0; i < NUMBER_DUNGEON_FEATURES; i++) {
+        readBytes(buf, &dungeonFeatureCatalog[i].messageDisplayed, sizeof(boolean));
+    }
+}
+
+static void writeSnapshotState(snapshotBuffer *buf) {
+    pointerList creatures = {0}, items = {0};
+    playerCharacter rogueCopy = rogue;
+    uint32_t RNGs[NUMBER_OF_RNGS][4];
+    flare flareCopy;
+    short i;
+
+    listAllCreatures(&creatures);
+
+    writeBytes(buf, snapshotLayout, sizeof(snapshotLayout));
+    writeBytes(buf, &rogue.playerTurnNumber, sizeof(unsigned long));
+    writeBytes(buf, &recordingLocation, sizeof(unsigned long));
+
+    getRNGState(RNGs);
+    writeBytes(buf, RNGs, sizeof(RNGs));
+    writeBytes(buf, &randomNumbersGenerated, sizeof(randomNumbersGenerated));
+
+    writeBytes(buf, pmap, sizeof(pmap));
+    writeBytes(buf, rmap, sizeof(rmap));
+    writeBytes(buf, tmap, sizeof(tmap));
+    writeBytes(buf, terrainRandomValues, sizeof(terrainRandomValues));
+    writeBytes(buf, &numberOfWaypoints, sizeof(numberOfWaypoints));
+    writeBytes(buf, displayedMessage, sizeof(displayedMessage));
+    writeBytes(buf, messageConfirmed, sizeof(messageConfirmed));
+    writeBytes(buf, combatText, sizeof(combatText));
+    writeBytes(buf, &messageArchivePosition, sizeof(messageArchivePosition));
+    writeBytes(buf, messageArchive, sizeof(messageArchive));
+    writeItemKnowledge(buf);
+
+    writeGrid(buf, safetyMap);
+    writeGrid(buf, allySafetyMap);
+    writeGrid(buf, chokeMap);
+
+    writeCreature(buf, &player, &creatures, &items);
+    writeCreatureChain(buf, monsters->nextCreature, &creatures, &items);
+    writeCreatureChain(buf, dormantMonsters->nextCreature, &creatures, &items);
+    writeCreatureChain(buf, graveyard->nextCreature, &creatures, &items);
+    writeCreatureChain(buf, purgatory->nextCreature, &creatures, &items);
+    writeItemChain(buf, packItems->nextItem, &items);
+    writeItemChain(buf, floorItems->nextItem, &items);
+    writeItemChain(buf, monsterItemsHopper->nextItem, &items);
+
+    // The maps themselves are kept apart from the rest of the state; see captureSnapshot.
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        writeBytes(buf, &levels[i].visited, sizeof(boolean));
+        writeBytes(buf, &levels[i].levelSeed, sizeof(uint64_t));
+        writeBytes(buf, levels[i].upStairsLoc, sizeof(levels[i].upStairsLoc));
+        writeBytes(buf, levels[i].downStairsLoc, sizeof(levels[i].downStairsLoc));
+        writeBytes(buf, levels[i].playerExitedVia, sizeof(levels[i].playerExitedVia));
+        writeBytes(buf, &levels[i].awaySince, sizeof(unsigned long));
+        writeGrid(buf, levels[i].scentMap);
+        writeInt(buf, levels[i].scentMap != NULL && levels[i].scentMap == scentMap);
+        writeCreatureChain(buf, levels[i].monsters, &creatures, &items);
+        writeCreatureChain(buf, levels[i].dormantMonsters, &creatures, &items);
+        writeItemChain(buf, levels[i].items, &items);
+    }
+
+    rogueCopy.weapon = rogueCopy.armor = rogueCopy.ringLeft = rogueCopy.ringRight = rogueCopy.lastItemThrown = NULL;
+    rogueCopy.yendorWarden = rogueCopy.lastTarget = NULL;
+    rogueCopy.flares = NULL;
+    rogueCopy.minersLight.lightColor = NULL;
+    rogueCopy.mapToShore = rogueCopy.mapToSafeTerrain = NULL;
+    for (i = 0; i < MAX_WAYPOINT_COUNT; i++) {
+        rogueCopy.wpDistance[i] = NULL;
+    }
+    writeBytes(buf, &rogueCopy, sizeof(playerCharacter));
+    writeInt(buf, pointerIndex(&items, rogue.weapon));
+    writeInt(buf, pointerIndex(&items, rogue.armor));
+    writeInt(buf, pointerIndex(&items, rogue.ringLeft));
+    writeInt(buf, pointerIndex(&items, rogue.ringRight));
+    writeInt(buf, pointerIndex(&items, rogue.lastItemThrown));
+    writeInt(buf, pointerIndex(&creatures, rogue.yendorWarden));
+    writeInt(buf, pointerIndex(&creatures, rogue.lastTarget));
+    writeColor(buf, rogue.minersLight.lightColor);
+    writeGrid(buf, rogue.mapToShore);
+    writeGrid(buf, rogue.mapToSafeTerrain);
+    for (i = 0; i < MAX_WAYPOINT_COUNT; i++) {
+        writeGrid(buf, rogue.wpDistance[i]);
+    }
+    for (i = 0; i < rogue.flareCount; i++) {
+        flareCopy = *(rogue.flares[i]);
+        flareCopy.light = NULL;
+        writeBytes(buf, &flareCopy, sizeof(flare));
+        if (rogue.flares[i]->light >= lightCatalog && rogue.flares[i]->light < lightCatalog + NUMBER_LIGHT_KINDS) {
+            writeInt(buf, rogue.flares[i]->light - lightCatalog);
+        } else {
+            buf->failed = true;
+        }
+    }
+
+    free(creatures.pointers);
+    free(items.pointers);
+}
+
+// The pointers in rogue are all filled in afresh after this.
+static void checkRogue(snapshotBuffer *buf) {
+    short i;
+
+    checkRange(buf, rogue.depthLevel, 1, DEEPEST_LEVEL);
+    checkRange(buf, rogue.deepestLevel, 1, DEEPEST_LEVEL);
+    checkRange(buf, rogue.RNG, 0, NUMBER_OF_RNGS - 1);
+    checkRange(buf, rogue.flareCount, 0, rogue.flareCapacity);
+    checkLocation(buf, rogue.upLoc[0], rogue.upLoc[1]);
+    checkLocation(buf, rogue.downLoc[0], rogue.downLoc[1]);
+    checkOptionalLocation(buf, rogue.cursorLoc[0], rogue.cursorLoc[1]);
+    for (i = 0; i < ROWS * 2; i++) {
+        checkOptionalLocation(buf, rogue.sidebarLocationList[i][0], rogue.sidebarLocationList[i][1]);
+    }
+    checkRange(buf, rogue.wpCount, 0, MAX_WAYPOINT_COUNT);
+    for (i = 0; i < rogue.wpCount && i < MAX_WAYPOINT_COUNT; i++) {
+        checkLocation(buf, rogue.wpCoordinates[i][0], rogue.wpCoordinates[i][1]);
+    }
+    checkString(buf, rogue.nextAnnotation, sizeof(rogue.nextAnnotation));
+}
+
+static void readSnapshotState(snapshotBuffer *buf) {
+    pointerList creatures = {0}, leaderIndices = {0}, items = {0};
+    uint32_t RNGs[NUMBER_OF_RNGS][4];
+    unsigned long layout[sizeof(snapshotLayout) / sizeof(*snapshotLayout)];
+    unsigned long turnNumber;
+    int index;
+    short i, j;
+
+    readBytes(buf, layout, sizeof(layout));
+    readBytes(buf, &turnNumber, sizeof(unsigned long));
+    readBytes(buf, &recordingLocation, sizeof(unsigned long));
+
+    readBytes(buf, RNGs, sizeof(RNGs));
+    setRNGState(RNGs);
+    readBytes(buf, &randomNumbersGenerated, sizeof(randomNumbersGenerated));
+
+    readBytes(buf, pmap, sizeof(pmap));
+    readBytes(buf, rmap, sizeof(rmap));
+    readBytes(buf, tmap, sizeof(tmap));
+    readBytes(buf, terrainRandomValues, sizeof(terrainRandomValues));
+    readBytes(buf, &numberOfWaypoints, sizeof(numberOfWaypoints));
+    readBytes(buf, displayedMessage, sizeof(displayedMessage));
+    readBytes(buf, messageConfirmed, sizeof(messageConfirmed));
+    readBytes(buf, combatText, sizeof(combatText));
+    readBytes(buf, &messageArchivePosition, sizeof(messageArchivePosition));
+    readBytes(buf, messageArchive, sizeof(messageArchive));
+    readItemKnowledge(buf);
+    for (i = 0; i < DCOLS; i++) {
+        for (j = 0; j < DROWS; j++) {
+            checkCell(buf, &pmap[i][j]);
+            checkRememberedCell(buf, &rmap[i][j]);
+        }
+    }
+    checkRange(buf, numberOfWaypoints, 0, MAX_WAYPOINT_COUNT);
+    for (i = 0; i < MESSAGE_LINES; i++) {
+        checkString(buf, displayedMessage[i], sizeof(displayedMessage[i]));
+    }
+    checkString(buf, combatText, sizeof(combatText));
+    checkRange(buf, messageArchivePosition, 0, MESSAGE_ARCHIVE_LINES - 1);
+    for (i = 0; i < MESSAGE_ARCHIVE_LINES; i++) {
+        checkString(buf, messageArchive[i], sizeof(messageArchive[i]));
+    }
+
+    safetyMap = readGrid(buf);
+    allySafetyMap = readGrid(buf);
+    chokeMap = readGrid(buf);
+
+    monsters = newCreatureChainHead();
+    dormantMonsters = newCreatureChainHead();
+    graveyard = newCreatureChainHead();
+    purgatory = newCreatureChainHead();
+    packItems = newItemChainHead();
+    floorItems = newItemChainHead();
+    monsterItemsHopper = newItemChainHead();
+
+    readCreature(buf, &player, &creatures, &leaderIndices, &items);
+    monsters->nextCreature = readCreatureChain(buf, &creatures, &leaderIndices, &items);
+    dormantMonsters->nextCreature = readCreatureChain(buf, &creatures, &leaderIndices, &items);
+    graveyard->nextCreature = readCreatureChain(buf, &creatures, &leaderIndices, &items);
+    purgatory->nextCreature = readCreatureChain(buf, &creatures, &leaderIndices, &items);
+    packItems->nextItem = readItemChain(buf, &items);
+    floorItems->nextItem = readItemChain(buf, &items);
+    monsterItemsHopper->nextItem = readItemChain(buf, &items);
+
+    levels = malloc(sizeof(levelData) * (DEEPEST_LEVEL+1));
+    scentMap = NULL;
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        readBytes(buf, &levels[i].visited, sizeof(boolean));
+        readBytes(buf, &levels[i].levelSeed, sizeof(uint64_t));
+        readBytes(buf, levels[i].upStairsLoc, sizeof(levels[i].upStairsLoc));
+        readBytes(buf, levels[i].downStairsLoc, sizeof(levels[i].downStairsLoc));
+        readBytes(buf, levels[i].playerExitedVia, sizeof(levels[i].playerExitedVia));
+        readBytes(buf, &levels[i].awaySince, sizeof(unsigned long));
+        checkLocation(buf, levels[i].upStairsLoc[0], levels[i].upStairsLoc[1]);
+        checkLocation(buf, levels[i].downStairsLoc[0], levels[i].downStairsLoc[1]);
+        checkLocation(buf, levels[i].playerExitedVia[0], levels[i].playerExitedVia[1]);
+        levels[i].scentMap = readGrid(buf);
+        if (readInt(buf)) {
+            scentMap = levels[i].scentMap;
+        }
+        levels[i].monsters = readCreatureChain(buf, &creatures, &leaderIndices, &items);
+        levels[i].dormantMonsters = readCreatureChain(buf, &creatures, &leaderIndices, &items);
+        levels[i].items = readItemChain(buf, &items);
+    }
+
+    for (index = 0; index < creatures.count; index++) {
+        ((creature *) creatures.pointers[index])->leader = pointerAtIndex(buf, &creatures, (int) (intptr_t) leaderIndices.pointers[index]);
+    }
+
+    readBytes(buf, &rogue, sizeof(playerCharacter));
+    checkRogue(buf);
+    rogue.weapon = pointerAtIndex(buf, &items, readInt(buf));
+    rogue.armor = pointerAtIndex(buf, &items, readInt(buf));
+    rogue.ringLeft = pointerAtIndex(buf, &items, readInt(buf));
+    rogue.ringRight = pointerAtIndex(buf, &items, readInt(buf));
+    rogue.lastItemThrown = pointerAtIndex(buf, &items, readInt(buf));
+    rogue.yendorWarden = pointerAtIndex(buf, &creatures, readInt(buf));
+    if (rogue.yendorWarden) {
+        checkRange(buf, rogue.yendorWarden->depth, 1, DEEPEST_LEVEL);
+    }
+    rogue.lastTarget = pointerAtIndex(buf, &creatures, readInt(buf));
+    rogue.minersLight.lightColor = readColor(buf);
+    rogue.mapToShore = readGrid(buf);
+    rogue.mapToSafeTerrain = readGrid(buf);
+    for (i = 0; i < MAX_WAYPOINT_COUNT; i++) {
+        rogue.wpDistance[i] = readGrid(buf);
+        if (!rogue.wpDistance[i]) {
+            buf->failed = true;
+            rogue.wpDistance[i] = allocGrid(); // freeEverything expects every one
+        }
+    }
+    rogue.flares = NULL;
+    if (rogue.flareCapacity > 0) {
+        rogue.flares = malloc(sizeof(flare *) * rogue.flareCapacity);
+    }
+    for (i = 0; i < rogue.flareCount && !buf->failed; i++) {
+        rogue.flares[i] = malloc(sizeof(flare));
+        readBytes(buf, rogue.flares[i], sizeof(flare));
+        checkLocation(buf, rogue.flares[i]->xLoc, rogue.flares[i]->yLoc);
+        index = readInt(buf);
+        if (index < 0 || index >= NUMBER_LIGHT_KINDS) {
+            buf->failed = true;
+            index = 0;
+        }
+        rogue.flares[i]->light = &lightCatalog[index];
+    }
+    rogue.flareCount = i; // only those read, for freeEverything to free if the restore fails
+
+    free(creatures.pointers);
+    free(leaderIndices.pointers);
+    free(items.pointers);
+}
+
+// Returns NULL if some part of the game can't be captured. Maps of levels that haven't
+// changed since the previous snapshot are shared with it rather than copied.
+snapshot *captureSnapshot(const snapshot *previous) {
+    snapshotBuffer buf = {0};
+    snapshot *theSnapshot;
+    short i;
+
+    writeSnapshotState(&buf);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+
+    theSnapshot = malloc(sizeof(snapshot));
+    theSnapshot->playerTurnNumber = rogue.playerTurnNumber;
+    theSnapshot->recordingLocation = recordingLocation;
+    theSnapshot->state = realloc(buf.data, buf.length);
+    theSnapshot->stateLength = buf.length;
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        theSnapshot->levelMaps[i] = NULL;
+        theSnapshot->ownsLevelMap[i] = false;
+        if (!levels[i].visited) {
+            continue; // never read until the level is generated
+        }
+        if (previous && previous->levelMaps[i]
+            && !memcmp(previous->levelMaps[i], levels[i].mapStorage, sizeof(levels[i].mapStorage))) {
+
+            theSnapshot->levelMaps[i] = previous->levelMaps[i];
+        } else {
+            theSnapshot->levelMaps[i] = malloc(sizeof(levels[i].mapStorage));
+            memcpy(theSnapshot->levelMaps[i], levels[i].mapStorage, sizeof(levels[i].mapStorage));
+            theSnapshot->ownsLevelMap[i] = true;
+        }
+    }
+    return theSnapshot;
+}
+
+// Replaces the game in progress with the snapshot. How the game is being viewed
+// (playback speed, omniscience and the like) is left as it is.
+boolean restoreSnapshot(const snapshot *theSnapshot) {
+    snapshotBuffer buf = {0};
+    playerCharacter viewer = rogue;
+    short i;
+
+    if (theSnapshot->stateLength < sizeof(snapshotLayout)
+        || memcmp(theSnapshot->state, snapshotLayout, sizeof(snapshotLayout))) {
+        return false;
+    }
+
+    freeEverything();
+
+    buf.data = theSnapshot->state;
+    buf.length = theSnapshot->stateLength;
+    readSnapshotState(&buf);
+    findActiveEnvironmentCells();
+
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        if (theSnapshot->levelMaps[i]) {
+            memcpy(levels[i].mapStorage, theSnapshot->levelMaps[i], sizeof(levels[i].mapStorage));
+        }
+    }
+
+    rogue.playbackMode          = viewer.playbackMode;
+    rogue.howManyTurns          = viewer.howManyTurns;
+    rogue.playbackDelayPerTurn  = viewer.playbackDelayPerTurn;
+    rogue.playbackDelayThisTurn = viewer.playbackDelayThisTurn;
+    rogue.playbackPaused        = viewer.playbackPaused;
+    rogue.playbackFastForward   = viewer.playbackFastForward;
+    rogue.playbackOmniscience   = viewer.playbackOmniscience;
+    rogue.trueColorMode         = viewer.trueColorMode;
+    rogue.displayAggroRangeMode = viewer.displayAggroRangeMode;
+    rogue.nextGame              = viewer.nextGame;
+    rogue.nextGameSeed          = viewer.nextGameSeed;
+    strcpy(rogue.nextGamePath, viewer.nextGamePath);
+
+    updateColors();
+    return !buf.failed;
+}
+
+void freeSnapshot(snapshot *theSnapshot) {
+    short i;
+
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        if (theSnapshot->ownsLevelMap[i]) {
+            free(theSnapshot->levelMaps[i]);
+        }
+    }
+    free(theSnapshot->state);
+    free(theSnapshot);
+}
+
+#define SNAPSHOT_TAG    "Brogue snapshot" // sixteen bytes with the terminator
+
+static uint32_t updateChecksum(uint32_t checksum, const unsigned char *data, unsigned long length) {
+    unsigned long i;
+
+    for (i = 0; i < length; i++) {
+        checksum = (checksum ^ data[i]) * 16777619; // FNV-1a
+    }
+    return checksum;
+}
+
+static uint32_t snapshotChecksum(const snapshot *theSnapshot) {
+    uint32_t checksum = 2166136261u;
+    short i;
+
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        if (theSnapshot->levelMaps[i]) {
+            checksum = updateChecksum(checksum, (unsigned char *) theSnapshot->levelMaps[i], sizeof(levels[i].mapStorage));
+        }
+    }
+    return updateChecksum(checksum, theSnapshot->state, theSnapshot->stateLength);
+}
+
+// The on-disk form: a tag, the version that wrote it, the turn number, the length and checksum
+// of the state, then each level's map (preceded by whether it has one), then the state.
+void writeSnapshot(FILE *file, const snapshot *theSnapshot) {
+    char version[16] = {0};
+    uint32_t header[3];
+    unsigned char present;
+    short i;
+
+    header[0] = theSnapshot->playerTurnNumber;
+    header[1] = theSnapshot->stateLength;
+    header[2] = snapshotChecksum(theSnapshot);
+    strncpy(version, BROGUE_RECORDING_VERSION_STRING, sizeof(version) - 1);
+    fwrite(SNAPSHOT_TAG, 1, sizeof(SNAPSHOT_TAG), file);
+    fwrite(version, 1, sizeof(version), file);
+    fwrite(header, sizeof(uint32_t), 3, file);
+    for (i = 0; i < DEEPEST_LEVEL+1; i++) {
+        present = (theSnapshot->levelMaps[i] != NULL);
+        fwrite(&present, 1, 1, file);
+        if (present) {
+            fwrite(theSnapshot->levelMaps[i], sizeof(levels[i].mapStorage), 1, file);
+        }
+    }
+    fwrite(theSnapshot->state, 1, theSnapshot->stateLength, file);
+}
+
+// Returns NULL unless the file holds a complete, intact snapshot that this build can restore.
+snapshot *readSnapshot(FILE *file) {
+    char tag[sizeof(SNAPSHOT_TAG)], version[16] = {0}, readVersion[16];
+    uint32_t header[3];
+    unsigned char present;
+    snapshot *theSnapshot;
+    snapshotBuffer check = {0}; // only for its failed flag
+    boolean intact;
+    short i;
+    int j;
+
+    strncpy(version, BROGUE_RECORDING_VERSION_STRING, sizeof(version) - 1);
+    if (fread(tag, 1, sizeof(tag), file) != sizeof(tag)
+        || memcmp(tag, SNAPSHOT_TAG, sizeof(tag))
+        || fread(readVersion, 1, sizeof(readVersion), file) != sizeof(readVersion)
+        || memcmp(readVersion, version, sizeof(version))
+        || fread(header, sizeof(uint32_t), 3, file) != 3
+        || header[1] < sizeof(snapshotLayout)
+        || header[1] > 64 * 1024 * 1024) {
+
+        return NULL;
+    }
+
+    theSnapshot = malloc(sizeof(snapshot));
+    memset(theSnapshot, 0, sizeof(snapshot));
+    theSnapshot->playerTurnNumber = header[0];
+    theSnapshot->stateLength = header[1];
+    theSnapshot->state = malloc(theSnapshot->stateLength);
+    intact = true;
+    for (i = 0; i < DEEPEST_LEVEL+1 && intact; i++) {
+        intact = (fread(&present, 1, 1, file) == 1);
+        if (intact && present) {
+            theSnapshot->levelMaps[i] = malloc(sizeof(levels[i].mapStorage));
+            theSnapshot->ownsLevelMap[i] = true;
+            intact = (fread(theSnapshot->levelMaps[i], sizeof(levels[i].mapStorage), 1, file) == 1);
+        }
+    }
+    for (i = 0; i < DEEPEST_LEVEL+1 && intact; i++) {
+        for (j = 0; theSnapshot->levelMaps[i] && j < DCOLS * DROWS; j++) {
+            checkCell(&check, &theSnapshot->levelMaps[i][j].cell);
+            checkRememberedCell(&check, &theSnapshot->levelMaps[i][j].remembered);
+        }
+    }
+    intact = (intact
+              && !check.failed
+              && fread(theSnapshot->state, 1, theSnapshot->stateLength, file) == theSnapshot->stateLength
+              && snapshotChecksum(theSnapshot) == header[2]
+              && !memcmp(theSnapshot->state, snapshotLayout, sizeof(snapshotLayout)));
+    if (!intact) {
+        freeSnapshot(theSnapshot);
+        return NULL;
+    }
+    return theSnapshot;
+}
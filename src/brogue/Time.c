@@ -212,6 +212,7 @@ void applyInstantTileEffectsToCreature(creature *monst) {
         && !(pmap[*x][*y].flags & PRESSURE_PLATE_DEPRESSED)) {
 
         pmap[*x][*y].flags |= PRESSURE_PLATE_DEPRESSED;
+        noteEnvironmentChangeAt(*x, *y);
         if (playerCanSee(*x, *y) && cellHasTMFlag(*x, *y, TM_IS_SECRET)) {
             discover(*x, *y);
             refreshDungeonCell(*x, *y);
@@ -1075,6 +1076,7 @@ void promoteTile(short x, short y, enum dungeonLayers layer, boolean useFireDF)
             rogue.staleLoopMap = true;
         }
         pmap[x][y].layers[layer] = (layer == DUNGEON ? FLOOR : NOTHING); // even the dungeon layer implicitly has floor underneath it
+        refreshTerrainFlags(x, y);
         if (layer == GAS) {
             pmap[x][y].volume = 0;
         }
@@ -1227,8 +1229,10 @@ void updateVolumetricMedia() {
                         newGasVolume[i][j] = min(3, newGasVolume[i][j]); // otherwise interactions between gases are crazy
                     }
                     pmap[i][j].layers[GAS] = gasType;
+                    refreshTerrainFlags(i, j);
                 } else if (pmap[i][j].layers[GAS] && newGasVolume[i][j] < 1) {
                     pmap[i][j].layers[GAS] = NOTHING;
+                    refreshTerrainFlags(i, j);
                     refreshDungeonCell(i, j);
                 }
                 if (pmap[i][j].volume > 0) {
@@ -1260,12 +1264,14 @@ void updateVolumetricMedia() {
                             newGasVolume[newX][newY] += (pmap[i][j].volume / numSpaces);
                             if (pmap[i][j].volume / numSpaces) {
                                 pmap[newX][newY].layers[GAS] = pmap[i][j].layers[GAS];
+                                refreshTerrainFlags(newX, newY);
                             }
                         }
                     }
                 }
                 newGasVolume[i][j] = 0;
                 pmap[i][j].layers[GAS] = NOTHING;
+                refreshTerrainFlags(i, j);
             }
         }
     }
@@ -1291,7 +1297,7 @@ void updateYendorWardenTracking() {
         return;
     }
     if (!(rogue.yendorWarden->bookkeepingFlags & MB_PREPLACED)) {
-        levels[rogue.yendorWarden->depth - 1].mapStorage[rogue.yendorWarden->xLoc][rogue.yendorWarden->yLoc].flags &= ~HAS_MONSTER;
+        levels[rogue.yendorWarden->depth - 1].mapStorage[rogue.yendorWarden->xLoc][rogue.yendorWarden->yLoc].cell.flags &= ~HAS_MONSTER;
     }
     n = rogue.yendorWarden->depth - 1;
 
@@ -1356,6 +1362,7 @@ void monstersFall() {
                      previousCreature->nextCreature != monst;
                      previousCreature = previousCreature->nextCreature);
                 previousCreature->nextCreature = monst->nextCreature;
+                forgetMonsterLocation(monst);
 
                 // add to next level's chain
                 monst->nextCreature = levels[rogue.depthLevel-1 + 1].monsters;
@@ -1374,8 +1381,60 @@ void monstersFall() {
     }
 }
 
+// The cells that updateEnvironment() has to look at: those with gas, fire, a promotion chance or a
+// tile that promotes without a key, and those flagged as having caught fire or holding down a pressure
+// plate. The set may also hold cells that have since gone quiet; they are dropped when next visited.
+static boolean activeEnvironmentCells[DCOLS][DROWS];
+static short activeEnvironmentCellsInColumn[DCOLS];
+
+static boolean environmentIsActiveAt(short x, short y) {
+    enum dungeonLayers layer;
+
+    if ((pmap[x][y].flags & (CAUGHT_FIRE_THIS_TURN | PRESSURE_PLATE_DEPRESSED))
+        || pmap[x][y].layers[GAS]
+        || (terrainFlags(x, y) & T_IS_FIRE)
+        || (terrainMechFlags(x, y) & TM_PROMOTES_WITHOUT_KEY)) {
+        return true;
+    }
+    for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
+        if (tileCatalog[pmap[x][y].layers[layer]].promoteChance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Called whenever a cell might have become active; cheap enough to call after every terrain change.
+void noteEnvironmentChangeAt(short x, short y) {
+    if (!activeEnvironmentCells[x][y] && environmentIsActiveAt(x, y)) {
+        activeEnvironmentCells[x][y] = true;
+        activeEnvironmentCellsInColumn[x]++;
+    }
+}
+
+// Rebuilds the set from scratch, for when the whole map has been replaced.
+void findActiveEnvironmentCells() {
+    short i, j;
+
+    memset(activeEnvironmentCells, 0, sizeof(activeEnvironmentCells));
+    memset(activeEnvironmentCellsInColumn, 0, sizeof(activeEnvironmentCellsInColumn));
+    for (i=0; i<DCOLS; i++) {
+        for (j=0; j<DROWS; j++) {
+            noteEnvironmentChangeAt(i, j);
+        }
+    }
+}
+
+static void forgetQuietEnvironmentCell(short x, short y) {
+    if (activeEnvironmentCells[x][y] && !environmentIsActiveAt(x, y)) {
+        activeEnvironmentCells[x][y] = false;
+        activeEnvironmentCellsInColumn[x]--;
+    }
+}
+
 void updateEnvironment() {
-    short i, j, direction, newX, newY, promotions[DCOLS][DROWS];
+    short i, j, direction, newX, newY, promotionCount;
+    static short promotions[DCOLS * DROWS][3];
     long promoteChance;
     enum dungeonLayers layer;
     floorTileType *tile;
@@ -1383,10 +1442,16 @@ void updateEnvironment() {
 
     monstersFall();
 
+    // Every pass below visits the active cells in the same column-major order as a full sweep of the map,
+    // and checks the set as it goes, so that cells activated by an earlier cell in the pass are still visited.
+
     // update gases twice
     for (i=0; i<DCOLS && !isVolumetricGas; i++) {
+        if (!activeEnvironmentCellsInColumn[i]) {
+            continue;
+        }
         for (j=0; j<DROWS && !isVolumetricGas; j++) {
-            if (!isVolumetricGas && pmap[i][j].layers[GAS]) {
+            if (activeEnvironmentCells[i][j] && pmap[i][j].layers[GAS]) {
                 isVolumetricGas = true;
             }
         }
@@ -1398,9 +1463,16 @@ void updateEnvironment() {
 
     // Do random tile promotions in two passes to keep generations distinct.
     // First pass, make a note of each terrain layer at each coordinate that is going to promote:
+    promotionCount = 0;
     for (i=0; i<DCOLS; i++) {
+        if (!activeEnvironmentCellsInColumn[i]) {
+            continue;
+        }
         for (j=0; j<DROWS; j++) {
-            promotions[i][j] = 0;
+            if (!activeEnvironmentCells[i][j]) {
+                continue;
+            }
+            promotions[promotionCount][2] = 0;
             for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
                 tile = &(tileCatalog[pmap[i][j].layers[layer]]);
                 if (tile->promoteChance < 0) {
@@ -1419,28 +1491,37 @@ void updateEnvironment() {
                 if (promoteChance
                     && !(pmap[i][j].flags & CAUGHT_FIRE_THIS_TURN)
                     && rand_range(0, 10000) < promoteChance) {
-                    promotions[i][j] |= Fl(layer);
+                    promotions[promotionCount][2] |= Fl(layer);
                     //promoteTile(i, j, layer, false);
                 }
             }
+            if (promotions[promotionCount][2]) {
+                promotions[promotionCount][0] = i;
+                promotions[promotionCount][1] = j;
+                promotionCount++;
+            }
         }
     }
     // Second pass, do the promotions:
-    for (i=0; i<DCOLS; i++) {
-        for (j=0; j<DROWS; j++) {
-            for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
-                if ((promotions[i][j] & Fl(layer))) {
-                    //&& (tileCatalog[pmap[i][j].layers[layer]].promoteChance != 0)){
-                    // make sure that it's still a promotable layer
-                    promoteTile(i, j, layer, false);
-                }
+    for (i=0; i<promotionCount; i++) {
+        for (layer = 0; layer < NUMBER_TERRAIN_LAYERS; layer++) {
+            if ((promotions[i][2] & Fl(layer))) {
+                //&& (tileCatalog[pmap[i][j].layers[layer]].promoteChance != 0)){
+                // make sure that it's still a promotable layer
+                promoteTile(promotions[i][0], promotions[i][1], layer, false);
             }
         }
     }
 
     // Bookkeeping for fire, pressure plates and key-activated tiles.
     for (i=0; i<DCOLS; i++) {
+        if (!activeEnvironmentCellsInColumn[i]) {
+            continue;
+        }
         for (j=0; j<DROWS; j++) {
+            if (!activeEnvironmentCells[i][j]) {
+                continue;
+            }
             pmap[i][j].flags &= ~(CAUGHT_FIRE_THIS_TURN);
             if (!(pmap[i][j].flags & (HAS_PLAYER | HAS_MONSTER | HAS_ITEM))
                 && (pmap[i][j].flags & PRESSURE_PLATE_DEPRESSED)) {
@@ -1454,13 +1535,18 @@ void updateEnvironment() {
                     }
                 }
             }
+            forgetQuietEnvironmentCell(i, j);
         }
     }
 
     // Update fire.
     for (i=0; i<DCOLS; i++) {
+        if (!activeEnvironmentCellsInColumn[i]) {
+            continue;
+        }
         for (j=0; j<DROWS; j++) {
-            if (cellHasTerrainFlag(i, j, T_IS_FIRE) && !(pmap[i][j].flags & CAUGHT_FIRE_THIS_TURN)) {
+            if (activeEnvironmentCells[i][j]
+                && cellHasTerrainFlag(i, j, T_IS_FIRE) && !(pmap[i][j].flags & CAUGHT_FIRE_THIS_TURN)) {
                 exposeTileToFire(i, j, false);
                 for (direction=0; direction<4; direction++) {
                     newX = i + nbDirs[direction][0];
@@ -1831,7 +1917,7 @@ void monsterEntersLevel(creature *monst, short n) {
     char monstName[COLS], buf[COLS];
     boolean pit = false;
 
-    levels[n].mapStorage[monst->xLoc][monst->yLoc].flags &= ~HAS_MONSTER;
+    levels[n].mapStorage[monst->xLoc][monst->yLoc].cell.flags &= ~HAS_MONSTER;
 
     // place traversing monster near the stairs on this level
     if (monst->bookkeepingFlags & MB_APPROACHING_DOWNSTAIRS) {
@@ -2177,12 +2263,23 @@ static void recordCurrentCreatureHealths() {
     }
 }
 
+// The fewest ticks until any monster on the level gets a turn, or 10000 if there are none.
+static short soonestMonsterTurn() {
+    creature *monst;
+    short soonestTurn = 10000;
+
+    for (monst = monsters->nextCreature; monst != NULL; monst = monst->nextCreature) {
+        soonestTurn = min(soonestTurn, monst->ticksUntilTurn);
+    }
+    return soonestTurn;
+}
+
 // This is the dungeon schedule manager, called every time the player's turn comes to an end.
 // It hands control over to monsters until they've all expended their accumulated ticks,
 // updating the environment (gas spreading, flames spreading and burning out, etc.) every
 // 100 ticks.
 void playerTurnEnded() {
-    short soonestTurn, damage, turnsRequiredToShore, turnsToShore;
+    short soonestTurn, soonestMonsterTicks, damage, turnsRequiredToShore, turnsToShore;
     char buf[COLS], buf2[COLS];
     creature *monst, *monst2, *nextMonst;
     boolean fastForward = false;
@@ -2336,12 +2433,12 @@ void playerTurnEnded() {
 
         rogue.heardCombatThisTurn = false;
 
+        // After the first step, this is found by the final pass over the monsters that takes no turns,
+        // which leaves every monster as it is until the next step begins.
+        soonestMonsterTicks = soonestMonsterTurn();
+
         while (player.ticksUntilTurn > 0) {
-            soonestTurn = 10000;
-            for(monst = monsters->nextCreature; monst != NULL; monst = monst->nextCreature) {
-                soonestTurn = min(soonestTurn, monst->ticksUntilTurn);
-            }
-            soonestTurn = min(soonestTurn, player.ticksUntilTurn);
+            soonestTurn = min(soonestMonsterTicks, player.ticksUntilTurn);
             soonestTurn = min(soonestTurn, rogue.ticksTillUpdateEnvironment);
             for(monst = monsters->nextCreature; monst != NULL; monst = monst->nextCreature) {
                 monst->ticksUntilTurn -= soonestTurn;
@@ -2399,8 +2496,11 @@ void playerTurnEnded() {
                 refreshWaypoint(rogue.wpRefreshTicker);
             }
 
+            soonestMonsterTicks = 10000;
             for (monst = monsters->nextCreature; (monst != NULL) && (rogue.gameHasEnded == false); monst = monst->nextCreature) {
-                if (monst->ticksUntilTurn <= 0) {
+                if (monst->ticksUntilTurn > 0) {
+                    soonestMonsterTicks = min(soonestMonsterTicks, monst->ticksUntilTurn);
+                } else {
                     if (monst->currentHP > monst->info.maxHP) {
                         monst->currentHP = monst->info.maxHP;
                     }
@@ -2423,6 +2523,7 @@ void playerTurnEnded() {
                         }
                     }
                     monst = monsters; // loop through from the beginning to be safe
+                    soonestMonsterTicks = 10000;
                 }
             }
 
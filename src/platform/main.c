@@ -12,6 +12,9 @@ boolean serverMode = false;
 boolean hasGraphics = false;
 boolean graphicsEnabled = false;
 boolean isCsvFormat = false;
+#ifdef BROGUE_HEADLESS
+char keyScriptPath[BROGUE_FILENAME_MAX] = "";
+#endif
 
 static void printCommandlineHelp() {
     printf("%s",
@@ -31,10 +34,15 @@ static void printCommandlineHelp() {
 #endif
 #ifdef BROGUE_CURSES
     "--term         -t          run in ncurses-based terminal mode\n"
+#endif
+#ifdef BROGUE_HEADLESS
+    "--keys filename            read keystrokes from the file (- for stdin)\n"
+    "--benchmark [FILE]         time the core map kernels on fixed seeded levels\n"
+    "                           (optionally also writing the results to FILE as JSON)\n"
 #endif
     "--wizard       -W          run in wizard mode, invincible with powerful items\n"
-    "[--csv] --print-seed-catalog [START NUM LEVELS]\n"
-    "                           (optional csv format)\n"
+    "[--csv] [--jobs N] --print-seed-catalog [START NUM LEVELS]\n"
+    "                           (optional csv format; optionally split across N processes)\n"
     "                           prints a catalog of the first LEVELS levels of NUM\n"
     "                           seeds from seed START (defaults: 1 1000 5)\n"
     );
@@ -80,6 +88,8 @@ int main(int argc, char *argv[])
     currentConsole = webConsole;
 #elif BROGUE_CURSES
     currentConsole = cursesConsole;
+#elif BROGUE_HEADLESS
+    currentConsole = nullConsole;
 #endif
 
     rogue.nextGame = NG_NOTHING;
@@ -88,6 +98,7 @@ int main(int argc, char *argv[])
     rogue.wizard = false;
 
     boolean initialGraphics = false;
+    int seedCatalogJobs = 1;
 
     int i;
     for (i = 1; i < argc; i++) {
@@ -159,11 +170,11 @@ int main(int argc, char *argv[])
 
                 if (tryParseUint64(argv[i+1], &startingSeed) && tryParseUint64(argv[i+2], &numberOfSeeds)
                         && startingSeed > 0 && numberOfLevels <= 40) {
-                    printSeedCatalog(startingSeed, numberOfSeeds, numberOfLevels, isCsvFormat);
+                    printSeedCatalog(startingSeed, numberOfSeeds, numberOfLevels, isCsvFormat, seedCatalogJobs);
                     return 0;
                 }
             } else {
-                printSeedCatalog(1, 1000, 5, isCsvFormat);
+                printSeedCatalog(1, 1000, 5, isCsvFormat, seedCatalogJobs);
                 return 0;
             }
         }
@@ -188,6 +199,14 @@ int main(int argc, char *argv[])
             continue;
         }
 
+        if (strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                seedCatalogJobs = atoi(argv[i + 1]);  // we call printSeedCatalog later
+                i++;
+                continue;
+            }
+        }
+
 #ifdef BROGUE_SDL
         if (strcmp(argv[i], "--size") == 0) {
             // pick a font size
@@ -207,6 +226,21 @@ int main(int argc, char *argv[])
         }
 #endif
 
+#ifdef BROGUE_HEADLESS
+        if (strcmp(argv[i], "--keys") == 0) {
+            if (i + 1 < argc) {
+                strncpy(keyScriptPath, argv[i + 1], BROGUE_FILENAME_MAX);
+                keyScriptPath[BROGUE_FILENAME_MAX - 1] = '\0';
+                i++;
+                continue;
+            }
+        }
+
+        if (strcmp(argv[i], "--benchmark") == 0) {
+            return runBenchmarks(i + 1 < argc ? argv[i + 1] : NULL) ? 0 : 1;
+        }
+#endif
+
 #ifdef BROGUE_WEB
         if(strcmp(argv[i], "--server-mode") == 0) {
             currentConsole = webConsole;
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+
+/*
+The null console draws nothing and never sleeps. Input comes from a key script
+(see --keys): every byte of the script is delivered as one keystroke, so a
+newline is RETURN_KEY and \033 is ESCAPE_KEY. Recordings opened with -v play
+back on their own; the console only unpauses them.
+
+Input is only ever reported as pending when there is nothing left to do: at
+the title menu, or when a recording has gone out of sync. Long-running commands
+(travel, explore, autopilot) are never interrupted. Once the script runs out,
+the next request for input quits the game, so a run always terminates. A game
+quit this way prints its result like any other, and its LastGame file is deleted
+(a game the player has saved keeps its save).
+*/
+
+extern creature *monsters;
+extern char currentFilePath[BROGUE_FILENAME_MAX];
+
+static FILE *keyScript = NULL;
+static boolean viewingRecording = false;
+static boolean scriptEndedGame = false; // and the game hasn't reported a result of its own since
+static long scriptEndedScore;
+static char scriptEndedDescription[DCOLS];
+static char scriptEndedPath[BROGUE_FILENAME_MAX]; // the scratch file to delete, or empty if the game was saved
+
+static void null_notifyEvent(short eventId, int data1, int data2, const char *str1, const char *str2);
+
+static void gameLoop() {
+    viewingRecording = (rogue.nextGame == NG_VIEW_RECORDING);
+
+    if (keyScriptPath[0]) {
+        if (strcmp(keyScriptPath, "-") == 0) {
+            keyScript = stdin;
+        } else {
+            keyScript = fopen(keyScriptPath, "rb");
+            if (keyScript == NULL) {
+                fprintf(stderr, "Could not open key script %s\n", keyScriptPath);
+                return;
+            }
+        }
+    }
+
+    rogueMain();
+
+    if (scriptEndedGame) {
+        // Report the game that the script left unfinished as gameOver would a quit, and don't leave its save behind.
+        null_notifyEvent(GAMEOVER_QUIT, scriptEndedScore, 0, scriptEndedDescription, "");
+        if (scriptEndedPath[0]) {
+            remove(scriptEndedPath);
+        }
+    }
+
+    if (keyScript != NULL && keyScript != stdin) {
+        fclose(keyScript);
+    }
+}
+
+static int peekKey() {
+    int key;
+
+    if (keyScript == NULL) {
+        return EOF;
+    }
+    key = getc(keyScript);
+    if (key != EOF) {
+        ungetc(key, keyScript);
+    }
+    return key;
+}
+
+static boolean recordingIsPlaying() {
+    return viewingRecording && !rogue.playbackOOS && !rogue.gameHasEnded;
+}
+
+static boolean nothingLeftToDo() {
+    // no game in progress means we're at the title menu
+    return monsters == NULL || rogue.playbackOOS;
+}
+
+// Notes the game that the end of the key script is cutting short, so that its result can be reported once it's over.
+static void endScriptedGame() {
+    scriptEndedScore = rogue.gold;
+    if (rogue.easyMode) {
+        scriptEndedScore /= 10;
+    }
+    sprintf(scriptEndedDescription, "Quit on depth %i.", rogue.depthLevel);
+
+    // Once the player has saved the game, currentFilePath is their save rather than the LastGame scratch file.
+    if (strncmp(currentFilePath, LAST_GAME_NAME, strlen(LAST_GAME_NAME)) == 0) {
+        strcpy(scriptEndedPath, currentFilePath);
+    } else {
+        scriptEndedPath[0] = '\0';
+    }
+    scriptEndedGame = true;
+}
+
+// Never sleep. Timing must not change what the game does.
+static boolean null_pauseForMilliseconds(short milliseconds) {
+    return nothingLeftToDo();
+}
+
+static void null_nextKeyOrMouseEvent(rogueEvent *returnEvent, boolean textInput, boolean colorsDance) {
+    returnEvent->eventType = KEYSTROKE;
+    returnEvent->controlKey = false;
+    returnEvent->shiftKey = false;
+    returnEvent->param2 = 0;
+
+    if (nothingLeftToDo() || peekKey() == EOF && !recordingIsPlaying()) {
+        if (rogue.playbackOOS) {
+            fprintf(stderr, "Playback out of sync at turn %li\n", rogue.playerTurnNumber);
+        } else if (monsters != NULL && !rogue.playbackMode && !rogue.gameHasEnded) {
+            endScriptedGame();
+        }
+        rogue.gameHasEnded = true;
+        rogue.nextGame = NG_QUIT; // causes the menu to drop out immediately
+        returnEvent->param1 = ESCAPE_KEY;
+    } else if (peekKey() != EOF) {
+        returnEvent->param1 = getc(keyScript);
+        if (returnEvent->param1 >= 'A' && returnEvent->param1 <= 'Z') {
+            returnEvent->shiftKey = true;
+        }
+    } else {
+        // the recording is paused; play it
+        returnEvent->param1 = ACKNOWLEDGE_KEY;
+    }
+}
+
+static void null_plotChar(enum displayGlyph inputChar,
+                          short xLoc, short yLoc,
+                          short foreRed, short foreGreen, short foreBlue,
+                          short backRed, short backGreen, short backBlue) {
+    // Nothing to draw
+}
+
+static void null_remap(const char *input_name, const char *output_name) {
+    // Not needed, scripted keys are delivered as-is
+}
+
+static boolean null_modifierHeld(int modifier) {
+    return false;
+}
+
+static void null_notifyEvent(short eventId, int data1, int data2, const char *str1, const char *str2) {
+    static const char eventNames[][16] = {"quit", "death", "victory", "supervictory", "recording"};
+
+    if (eventId == GAMEOVER_RECORDING) {
+        viewingRecording = false;
+    }
+    scriptEndedGame = false;
+
+    if (eventId >= 0 && eventId < sizeof(eventNames) / sizeof(*eventNames)) {
+        printf("%s\t%i\t%li\t%s\n", eventNames[eventId], data1, rogue.playerTurnNumber, str1);
+    }
+}
+
+struct brogueConsole nullConsole = {
+    gameLoop,
+    null_pauseForMilliseconds,
+    null_nextKeyOrMouseEvent,
+    null_plotChar,
+    null_remap,
+    null_modifierHeld,
+    null_notifyEvent,
+    NULL,
+    NULL
+};
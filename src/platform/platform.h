@@ -102,6 +102,11 @@ extern struct brogueConsole cursesConsole;
 extern struct brogueConsole webConsole;
 #endif
 
+#ifdef BROGUE_HEADLESS
+extern struct brogueConsole nullConsole;
+extern char keyScriptPath[];
+#endif
+
 extern struct brogueConsole currentConsole;
 extern boolean noMenu;
 extern int brogueFontSize;
@@ -21,6 +21,8 @@
  *  along with Brogue.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
@@ -28,6 +30,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "platform.h"
 
@@ -563,6 +569,96 @@ void initializeLaunchArguments(enum NGCommands *command, char *path, uint64_t *s
     // we've actually already done this at this point, except for the seed.
 }
 
+#ifndef _WIN32
+// Scans the seeds into the given file by temporarily pointing stdout at it.
+static void scanSeedCatalogShard(FILE *shard, uint64_t startingSeed, uint64_t numberOfSeedsToScan,
+                                 unsigned int scanThroughDepth, boolean isCsvFormat, int jobNumber) {
+    char scratchName[BROGUE_FILENAME_MAX];
+    int savedStdout;
+
+    sprintf(scratchName, "%s (job %i)", LAST_GAME_NAME, jobNumber);
+
+    fflush(stdout);
+    savedStdout = dup(STDOUT_FILENO);
+    dup2(fileno(shard), STDOUT_FILENO);
+    scanSeedCatalog(startingSeed, numberOfSeedsToScan, scanThroughDepth, isCsvFormat, scratchName);
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+}
+#endif
+
+// Splits the seeds into contiguous shards, one per worker process. Each worker writes its part of
+// the catalog to a temporary file, and the shards are copied to stdout in seed order once all of
+// the workers are done. Returns false, having scanned nothing, if the platform can't do this.
+boolean scanSeedCatalogInParallel(uint64_t startingSeed, uint64_t numberOfSeedsToScan, unsigned int scanThroughDepth,
+                                  boolean isCsvFormat, int jobs) {
+#ifdef _WIN32
+    return false;
+#else
+    FILE *shards[jobs];
+    pid_t workers[jobs];
+    uint64_t shardStart[jobs + 1];
+    char buffer[4096];
+    size_t n;
+    int i, status;
+    boolean success = true;
+
+    if ((uint64_t) jobs > numberOfSeedsToScan) {
+        jobs = numberOfSeedsToScan;
+    }
+
+    for (i = 0; i <= jobs; i++) {
+        shardStart[i] = startingSeed + numberOfSeedsToScan / jobs * i + min((uint64_t) i, numberOfSeedsToScan % jobs);
+    }
+
+    for (i = 0; i < jobs; i++) {
+        shards[i] = tmpfile();
+        if (shards[i] == NULL) {
+            while (--i >= 0) {
+                fclose(shards[i]);
+            }
+            return false;
+        }
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    for (i = 0; i < jobs; i++) {
+        workers[i] = fork();
+        if (workers[i] == 0) {
+            scanSeedCatalogShard(shards[i], shardStart[i], shardStart[i + 1] - shardStart[i], scanThroughDepth, isCsvFormat, i + 1);
+            _exit(0);
+        }
+    }
+
+    for (i = 0; i < jobs; i++) {
+        if (workers[i] < 0) {
+            // couldn't start a worker for this shard, so scan it here
+            scanSeedCatalogShard(shards[i], shardStart[i], shardStart[i + 1] - shardStart[i], scanThroughDepth, isCsvFormat, i + 1);
+        } else if (waitpid(workers[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Seed catalog job %i (seeds %llu to %llu) failed.\n",
+                    i + 1, (unsigned long long) shardStart[i], (unsigned long long) shardStart[i + 1] - 1);
+            success = false;
+        }
+    }
+
+    for (i = 0; i < jobs; i++) {
+        rewind(shards[i]);
+        while (success && (n = fread(buffer, 1, sizeof(buffer), shards[i])) > 0) {
+            fwrite(buffer, 1, n, stdout);
+        }
+        fclose(shards[i]);
+    }
+    fflush(stdout);
+
+    if (!success) {
+        exit(1);
+    }
+    return true;
+#endif
+}
+
 boolean isApplicationActive(void) {
     // FIXME: finish
     return true;
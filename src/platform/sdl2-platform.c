@@ -28,6 +28,9 @@ static SDL_Surface *WinSurf = NULL;
 static SDL_Surface *Font = NULL;
 static SDL_Surface *Tiles = NULL;
 
+// Whether the whole window has to be pushed to the screen at the next update, rather than just the dirty rows.
+static boolean wholeWindowDirty = true;
+
 static struct keypair remapping[MAX_REMAPS];
 static size_t nremaps = 0;
 static boolean showGraphics = false;
@@ -51,6 +54,7 @@ static void refreshWindow() {
     WinSurf = SDL_GetWindowSurface(Win);
     if (WinSurf == NULL) sdlfatal();
     SDL_FillRect(WinSurf, NULL, SDL_MapRGB(WinSurf->format, 0, 0, 0));
+    wholeWindowDirty = true;
     refreshScreen();
 }
 
@@ -261,6 +265,8 @@ static boolean pollBrogueEvent(rogueEvent *returnEvent, boolean textInput) {
             brogueFontSize = fitFontSize(event.window.data1, event.window.data2);
             loadFont(brogueFontSize);
             refreshWindow();
+        } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+            wholeWindowDirty = true;
         } else if (event.type == SDL_KEYDOWN) {
             SDL_Keycode key = event.key.keysym.sym;
 
@@ -343,6 +349,240 @@ static boolean pollBrogueEvent(rogueEvent *returnEvent, boolean textInput) {
 }
 
 
+/*
+Glyphs are drawn from surfaces that have already been tinted with their
+foreground colour, kept in a least-recently-used cache keyed on the sprite,
+the colour and the font size. Tinting the shared font sheet with
+SDL_SetSurfaceColorMod for every cell kept SDL off its fast blitters.
+*/
+#define GLYPH_CACHE_SIZE     1024
+#define GLYPH_CACHE_BUCKETS  2048 // a power of two
+
+typedef struct glyphCacheEntry {
+    uint64_t key;
+    SDL_Surface *surface; // NULL if the glyph has no visible pixels, like a space
+    struct glyphCacheEntry *nextInBucket;
+    struct glyphCacheEntry *newer, *older;
+} glyphCacheEntry;
+
+static glyphCacheEntry glyphCache[GLYPH_CACHE_SIZE];
+static glyphCacheEntry *glyphBuckets[GLYPH_CACHE_BUCKETS];
+static glyphCacheEntry *newestGlyph = NULL, *oldestGlyph = NULL;
+static int cachedGlyphCount = 0;
+
+
+static uint64_t glyphKey(int sprite, Uint8 red, Uint8 green, Uint8 blue) {
+    return ((uint64_t) brogueFontSize << 40) | ((uint64_t) sprite << 24)
+        | ((uint64_t) red << 16) | ((uint64_t) green << 8) | blue;
+}
+
+
+static unsigned int glyphBucket(uint64_t key) {
+    return (unsigned int) ((key * 0x9E3779B97F4A7C15ULL) >> 40) & (GLYPH_CACHE_BUCKETS - 1);
+}
+
+
+static void unlinkCachedGlyph(glyphCacheEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else newestGlyph = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else oldestGlyph = entry->newer;
+}
+
+
+static void makeNewestCachedGlyph(glyphCacheEntry *entry) {
+    entry->newer = NULL;
+    entry->older = newestGlyph;
+    if (newestGlyph) newestGlyph->newer = entry;
+    newestGlyph = entry;
+    if (oldestGlyph == NULL) oldestGlyph = entry;
+}
+
+
+/*
+Copies a sprite out of its sheet, tinted, into a surface of its own. Returns
+NULL if nothing of it would show.
+*/
+static SDL_Surface *tintGlyph(int sprite, Uint8 red, Uint8 green, Uint8 blue) {
+    SDL_Surface *sheet = (sprite >= 256 ? Tiles : Font);
+    int cellw = fontWidths[brogueFontSize - 1], cellh = fontHeights[brogueFontSize - 1];
+    SDL_BlendMode sheetBlendMode;
+    SDL_Rect src;
+
+    sprite %= 256;
+    src.x = (sprite % 16) * cellw;
+    src.y = (sprite / 16) * cellh;
+    src.w = cellw;
+    src.h = cellh;
+
+    SDL_Surface *glyph = SDL_CreateRGBSurfaceWithFormat(0, cellw, cellh, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (glyph == NULL) sdlfatal();
+
+    // Copy the pixels and their alpha as they are, and blend them only when drawing the glyph.
+    SDL_GetSurfaceBlendMode(sheet, &sheetBlendMode);
+    SDL_SetSurfaceBlendMode(sheet, SDL_BLENDMODE_NONE);
+    SDL_SetSurfaceColorMod(sheet, red, green, blue);
+    SDL_BlitSurface(sheet, &src, glyph, NULL);
+    SDL_SetSurfaceBlendMode(sheet, sheetBlendMode);
+    SDL_SetSurfaceBlendMode(glyph, SDL_BLENDMODE_BLEND);
+
+    for (int y = 0; y < cellh; y++) {
+        const Uint32 *row = (const Uint32 *) ((const Uint8 *) glyph->pixels + y * glyph->pitch);
+        for (int x = 0; x < cellw; x++) {
+            if (row[x] >> 24) return glyph;
+        }
+    }
+    SDL_FreeSurface(glyph);
+    return NULL;
+}
+
+
+static glyphCacheEntry *cachedGlyph(int sprite, Uint8 red, Uint8 green, Uint8 blue) {
+    uint64_t key = glyphKey(sprite, red, green, blue);
+    unsigned int bucket = glyphBucket(key);
+    glyphCacheEntry *entry, **link;
+
+    for (entry = glyphBuckets[bucket]; entry; entry = entry->nextInBucket) {
+        if (entry->key == key) {
+            if (entry != newestGlyph) {
+                unlinkCachedGlyph(entry);
+                makeNewestCachedGlyph(entry);
+            }
+            return entry;
+        }
+    }
+
+    if (cachedGlyphCount < GLYPH_CACHE_SIZE) {
+        entry = &glyphCache[cachedGlyphCount++];
+    } else {
+        // Evict the least recently drawn glyph.
+        entry = oldestGlyph;
+        unlinkCachedGlyph(entry);
+        for (link = &glyphBuckets[glyphBucket(entry->key)]; *link != entry; link = &(*link)->nextInBucket);
+        *link = entry->nextInBucket;
+        if (entry->surface) SDL_FreeSurface(entry->surface);
+    }
+
+    entry->key = key;
+    entry->surface = tintGlyph(sprite, red, green, blue);
+    entry->nextInBucket = glyphBuckets[bucket];
+    glyphBuckets[bucket] = entry;
+    makeNewestCachedGlyph(entry);
+    return entry;
+}
+
+
+/*
+Plots are held until the window is next updated, so that each cell is drawn
+once however often it was plotted, and the glyphs are drawn grouped together.
+*/
+typedef struct pendingPlot {
+    uint64_t key;
+    short x, y;
+    int sprite;
+    Uint8 fore[3], back[3];
+} pendingPlot;
+
+static pendingPlot pendingPlots[COLS * ROWS];
+static short pendingPlotAt[COLS][ROWS]; // index into pendingPlots plus one, or zero
+static int pendingPlotCount = 0;
+
+// The span of cells drawn in each row since the window was last updated; dirtyLeft is COLS for a clean row.
+static short dirtyLeft[ROWS], dirtyRight[ROWS];
+
+
+static void clearDirtyRows() {
+    for (int y = 0; y < ROWS; y++) {
+        dirtyLeft[y] = COLS;
+        dirtyRight[y] = -1;
+    }
+}
+
+
+static int comparePendingPlots(const void *a, const void *b) {
+    uint64_t keyA = ((const pendingPlot *) a)->key, keyB = ((const pendingPlot *) b)->key;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+
+static void drawPendingPlots() {
+    int cellw = fontWidths[brogueFontSize - 1], cellh = fontHeights[brogueFontSize - 1];
+    int padx = 0, pady = 0;
+    glyphCacheEntry *glyph = NULL;
+    SDL_Rect dest;
+
+    if (pendingPlotCount == 0 || WinSurf == NULL) return;
+    getWindowPadding(&padx, &pady);
+
+    for (int i = 0; i < pendingPlotCount; i++) {
+        pendingPlot *plot = &pendingPlots[i];
+        plot->key = glyphKey(plot->sprite, plot->fore[0], plot->fore[1], plot->fore[2]);
+        pendingPlotAt[plot->x][plot->y] = 0;
+        if (plot->x < dirtyLeft[plot->y]) dirtyLeft[plot->y] = plot->x;
+        if (plot->x > dirtyRight[plot->y]) dirtyRight[plot->y] = plot->x;
+    }
+    qsort(pendingPlots, pendingPlotCount, sizeof(pendingPlot), comparePendingPlots);
+
+    for (int i = 0; i < pendingPlotCount; i++) {
+        pendingPlot *plot = &pendingPlots[i];
+        if (i == 0 || plot->key != pendingPlots[i - 1].key) {
+            glyph = cachedGlyph(plot->sprite, plot->fore[0], plot->fore[1], plot->fore[2]);
+        }
+
+        dest.x = cellw * plot->x + padx;
+        dest.y = cellh * plot->y + pady;
+        dest.w = cellw;
+        dest.h = cellh;
+
+        SDL_FillRect(WinSurf, &dest, SDL_MapRGB(WinSurf->format, plot->back[0], plot->back[1], plot->back[2]));
+        if (glyph->surface) SDL_BlitSurface(glyph->surface, NULL, WinSurf, &dest);
+    }
+    pendingPlotCount = 0;
+}
+
+
+/*
+Pushes what has been drawn since the last update to the screen: the whole
+window if it was cleared or exposed, otherwise one rectangle for each run of
+rows with the same dirty span, and nothing at all if nothing was drawn.
+*/
+static void updateWindow() {
+    int cellw = fontWidths[brogueFontSize - 1], cellh = fontHeights[brogueFontSize - 1];
+    int padx = 0, pady = 0, rectCount = 0;
+    SDL_Rect rects[ROWS];
+
+    drawPendingPlots();
+
+    if (wholeWindowDirty) {
+        SDL_UpdateWindowSurface(Win);
+        wholeWindowDirty = false;
+        clearDirtyRows();
+        return;
+    }
+
+    getWindowPadding(&padx, &pady);
+    for (int y = 0; y < ROWS; y++) {
+        if (dirtyLeft[y] > dirtyRight[y]) continue;
+        if (rectCount > 0
+            && rects[rectCount - 1].y + rects[rectCount - 1].h == cellh * y + pady
+            && rects[rectCount - 1].x == cellw * dirtyLeft[y] + padx
+            && rects[rectCount - 1].w == cellw * (dirtyRight[y] - dirtyLeft[y] + 1)) {
+            rects[rectCount - 1].h += cellh;
+        } else {
+            rects[rectCount].x = cellw * dirtyLeft[y] + padx;
+            rects[rectCount].y = cellh * y + pady;
+            rects[rectCount].w = cellw * (dirtyRight[y] - dirtyLeft[y] + 1);
+            rects[rectCount].h = cellh;
+            rectCount++;
+        }
+    }
+    if (rectCount > 0) {
+        SDL_UpdateWindowSurfaceRects(Win, rects, rectCount);
+        clearDirtyRows();
+    }
+}
+
+
 static void _gameLoop() {
 #ifdef SDL_PATHS
     char *path = SDL_GetBasePath();
@@ -377,6 +617,7 @@ static void _gameLoop() {
 
     loadFont(brogueFontSize);
     ensureWindow();
+    clearDirtyRows();
 
     rogueMain();
 
@@ -386,7 +627,7 @@ static void _gameLoop() {
 
 
 static boolean _pauseForMilliseconds(short ms) {
-    SDL_UpdateWindowSurface(Win);
+    updateWindow();
     SDL_Delay(ms);
 
     if (lastEvent.eventType != EVENT_ERROR
@@ -403,7 +644,7 @@ static boolean _pauseForMilliseconds(short ms) {
 static void _nextKeyOrMouseEvent(rogueEvent *returnEvent, boolean textInput, boolean colorsDance) {
     long tstart, dt;
 
-    SDL_UpdateWindowSurface(Win);
+    updateWindow();
 
     if (lastEvent.eventType != EVENT_ERROR) {
         *returnEvent = lastEvent;
@@ -419,7 +660,7 @@ static void _nextKeyOrMouseEvent(rogueEvent *returnEvent, boolean textInput, boo
             commitDraws();
         }
 
-        SDL_UpdateWindowSurface(Win);
+        updateWindow();
 
         if (pollBrogueEvent(returnEvent, textInput)) break;
 
@@ -486,35 +727,24 @@ static void _plotChar(
     short foreRed, short foreGreen, short foreBlue,
     short backRed, short backGreen, short backBlue
 ) {
-    int padx, pady;
-    getWindowPadding(&padx, &pady);
+    pendingPlot *plot;
 
-    SDL_Surface *sheet;
-    inputChar = fontIndex(inputChar);
-    if (inputChar >= 256) {
-        sheet = Tiles;
-        inputChar -= 256;
+    if (pendingPlotAt[x][y]) {
+        plot = &pendingPlots[pendingPlotAt[x][y] - 1];
     } else {
-        sheet = Font;
+        plot = &pendingPlots[pendingPlotCount++];
+        pendingPlotAt[x][y] = pendingPlotCount;
+        plot->x = x;
+        plot->y = y;
     }
 
-    SDL_Rect src, dest;
-    int cellw = fontWidths[brogueFontSize - 1], cellh = fontHeights[brogueFontSize - 1];
-    src.x = (inputChar % 16) * cellw;
-    src.y = (inputChar / 16) * cellh;
-    src.w = cellw;
-    src.h = cellh;
-
-    dest.x = cellw * x + padx;
-    dest.y = cellh * y + pady;
-    dest.w = cellw;
-    dest.h = cellh;
-
-    SDL_FillRect(WinSurf, &dest, SDL_MapRGB(
-        WinSurf->format, backRed * 255 / 100, backGreen * 255 / 100, backBlue * 255 / 100
-    ));
-    SDL_SetSurfaceColorMod(sheet, foreRed * 255 / 100, foreGreen * 255 / 100, foreBlue * 255 / 100);
-    SDL_BlitSurface(sheet, &src, WinSurf, &dest);
+    plot->sprite = fontIndex(inputChar);
+    plot->fore[0] = foreRed * 255 / 100;
+    plot->fore[1] = foreGreen * 255 / 100;
+    plot->fore[2] = foreBlue * 255 / 100;
+    plot->back[0] = backRed * 255 / 100;
+    plot->back[1] = backGreen * 255 / 100;
+    plot->back[2] = backBlue * 255 / 100;
 }
 
 
@@ -537,6 +767,7 @@ static boolean _takeScreenshot() {
     strcat(screenshotFilepath, SCREENSHOT_SUFFIX);
 
     if (WinSurf) {
+        drawPendingPlots();
         IMG_SavePNG(WinSurf, screenshotFilepath);
         return true;
     }
@@ -29,15 +29,25 @@ typedef struct {
     int r, g, b, idx;
 } intcolor;
 
+// Pairs 16 to 255 are handed out to the colour combinations on the screen and
+// kept from one refresh to the next, so that the cells that haven't changed
+// keep their pairs and aren't sent to the terminal again.
+#define FIRST_PAIR 16
+#define LAST_PAIR 255
+
 struct {
     intcolor fore, back;
-    int count, next;
+    int count; // cells on the screen drawn with this pair
+    int defined;
 } prs[256];
 
+static short pair_of[256][256]; // pair by colour cube index of the fore and back colours, or 0
+static int next_spare_pair;
 
 typedef struct {
-    int ch, pair, shuffle;
+    int ch;
     intcolor fore, back;
+    int drawn_ch, drawn_pair; // what the screen shows; drawn_pair is 0 if the cell has to be drawn again
 } pairmode_cell;
 
 pairmode_cell *cell_buffer;
@@ -355,13 +365,22 @@ static int best (fcolor *fg, fcolor *bg) {
 
 
 static void initialize_prs() {
+    memset(prs, 0, sizeof(prs));
+    memset(pair_of, 0, sizeof(pair_of));
+    next_spare_pair = FIRST_PAIR;
+}
+
+// The screen has been cleared behind our back, so every cell has to be drawn again.
+static void forget_drawn_cells() {
     int i;
-    for (i = 16; i < 255; i++) {
-        prs[i].next = i + 1;
+    for (i = FIRST_PAIR; i <= LAST_PAIR; i++) {
+        prs[i].count = 0;
+    }
+    if (cell_buffer) {
+        for (i = 0; i < minsize.width * minsize.height; i++) {
+            cell_buffer[i].drawn_pair = 0;
+        }
     }
-    prs[0].next = 16;
-    prs[1].next = 0;
-    prs[255].next = 0;
 }
 
 static void coerce_colorcube (fcolor *f, intcolor *c) {
@@ -398,71 +417,45 @@ static int intcolor_distance (intcolor *a, intcolor *b) {
 }
 
 static int coerce_prs (intcolor *fg, intcolor *bg) {
-    // search for an exact match in the list
-    int pair;
-    pair = prs[1].next;
-    while (pair) {
-        if (prs[pair].fore.idx == fg->idx && prs[pair].back.idx == bg->idx) {
-            // perfect.
-            prs[pair].count++;
-            return pair;
-        }
-        pair = prs[pair].next;
-    }
-
-    // no exact match? try to insert it as a new one
-    pair = prs[0].next;
-    if (pair) {
-        // there's room!
-
-        // remove
-        prs[0].next = prs[pair].next;
+    // an exact match?
+    int pair = pair_of[fg->idx][bg->idx];
+    if (pair) return pair;
 
-        // insert at the front
-        prs[pair].next = prs[1].next;
-        prs[1].next = pair;
-
-        // initialize it
-        prs[pair].fore = *fg;
-        prs[pair].back = *bg;
-        prs[pair].count = 1;
+    // no exact match? take a pair that's not on the screen, going round them in turn
+    int i;
+    for (i = FIRST_PAIR; i <= LAST_PAIR; i++) {
+        pair = next_spare_pair;
+        next_spare_pair = (next_spare_pair == LAST_PAIR ? FIRST_PAIR : next_spare_pair + 1);
+        if (prs[pair].count == 0) {
+            if (prs[pair].defined) {
+                pair_of[prs[pair].fore.idx][prs[pair].back.idx] = 0;
+            }
+            prs[pair].fore = *fg;
+            prs[pair].back = *bg;
+            prs[pair].defined = 1;
+            pair_of[fg->idx][bg->idx] = pair;
 
-        init_pair(pair, fg->idx, bg->idx);
+            init_pair(pair, fg->idx, bg->idx);
 
-        return pair;
+            return pair;
+        }
     }
 
-    // search for an approximate match in the list
-    int bestpair = 0, bestscore = 2 * 3 * 6 * 6; // naive distance metric for now
-    pair = prs[1].next;
-    while (pair) {
+    // every pair is in use; search for an approximate match
+    int bestpair = FIRST_PAIR, bestscore = 2 * 3 * 6 * 6; // naive distance metric for now
+    for (pair = FIRST_PAIR; pair <= LAST_PAIR; pair++) {
         int delta = intcolor_distance(&prs[pair].fore, fg) + intcolor_distance(&prs[pair].back, bg);
         if (delta < bestscore) {
             bestscore = delta;
             bestpair = pair;
             if (delta == 1) break; // as good as it gets without being exact!
         }
-        pair = prs[pair].next;
     }
 
-    prs[bestpair].count++;
     return bestpair;
 }
 
-static void buffer_plot(int ch, int x, int y, fcolor *fg, fcolor *bg) {
-    // int pair = 256 + x + y * minsize.width;
-    // intcolor cube_fg, cube_bg;
-    // coerce_colorcube(fg, &cube_fg),
-    // coerce_colorcube(bg, &cube_bg);
-
-    // pair = cube_bg.idx;
-    // cube_fg = cube_bg;
-
-
-    // init_pair(pair, cube_fg.idx, cube_bg.idx);
-
-    // return pair;
-
+static void coerce_cube_pair(fcolor *fg, fcolor *bg, intcolor *cube_fg_out, intcolor *cube_bg_out) {
     intcolor cube_fg, cube_bg;
 
     coerce_colorcube(fg, &cube_fg);
@@ -481,43 +474,105 @@ static void buffer_plot(int ch, int x, int y, fcolor *fg, fcolor *bg) {
         }
     }
 
+    *cube_fg_out = cube_fg;
+    *cube_bg_out = cube_bg;
+}
+
+
+// Brogue's colours come in whole percentages, and a screen uses few
+// combinations of them, so the colour matching for each fore and back
+// combination is remembered rather than worked out for every cell.
+#define COERCION_CACHE_SIZE 8192 // a power of two
+
+static struct {
+    unsigned long long key; // 0 for an empty entry
+    int coloring; // for 16 colour mode
+    intcolor fore, back; // for 256 colour mode
+} coercion_cache[COERCION_CACHE_SIZE];
+
+static int percent_of(float f) {
+    int percent = (int) (f * 100 + 0.5);
+    // anything but a whole percentage from 0 to 100 isn't cached
+    return (percent >= 0 && percent <= 100 && (float) percent / 100 == f) ? percent : -1;
+}
+
+// Returns the cache entry for the colours, or -1 if they can't be cached.
+static int coercion_index(fcolor *fg, fcolor *bg, unsigned long long *key) {
+    int c[6] = {percent_of(fg->r), percent_of(fg->g), percent_of(fg->b),
+                percent_of(bg->r), percent_of(bg->g), percent_of(bg->b)};
+    int i;
+
+    *key = 1;
+    for (i = 0; i < 6; i++) {
+        if (c[i] < 0) return -1;
+        *key = (*key << 7) | c[i];
+    }
+    return (int) ((*key * 0x9E3779B97F4A7C15ULL) >> 40) & (COERCION_CACHE_SIZE - 1);
+}
+
+static int cached_best(fcolor *fg, fcolor *bg) {
+    unsigned long long key;
+    int i = coercion_index(fg, bg, &key);
+
+    if (i < 0) return best(fg, bg);
+    if (coercion_cache[i].key != key) {
+        coercion_cache[i].key = key;
+        coercion_cache[i].coloring = best(fg, bg);
+    }
+    return coercion_cache[i].coloring;
+}
+
+static void cached_cube_pair(fcolor *fg, fcolor *bg, intcolor *cube_fg, intcolor *cube_bg) {
+    unsigned long long key;
+    int i = coercion_index(fg, bg, &key);
+
+    if (i < 0) {
+        coerce_cube_pair(fg, bg, cube_fg, cube_bg);
+        return;
+    }
+    if (coercion_cache[i].key != key) {
+        coercion_cache[i].key = key;
+        coerce_cube_pair(fg, bg, &coercion_cache[i].fore, &coercion_cache[i].back);
+    }
+    *cube_fg = coercion_cache[i].fore;
+    *cube_bg = coercion_cache[i].back;
+}
+
+static void buffer_plot(int ch, int x, int y, fcolor *fg, fcolor *bg) {
+    intcolor cube_fg, cube_bg;
+
+    cached_cube_pair(fg, bg, &cube_fg, &cube_bg);
+
     int cell = x + y * minsize.width;
     cell_buffer[cell].ch = ch;
-    cell_buffer[cell].pair = -1;
     cell_buffer[cell].fore = cube_fg;
     cell_buffer[cell].back = cube_bg;
 }
 
 static void buffer_render_256() {
-    // build a new palette
-    initialize_prs();
-
     int length = minsize.width * minsize.height;
-    int i, idx, x, y;
+    int i, pair;
 
+    // draw only the cells that have changed since the last refresh
     for (i = 0; i < length; i++) {
-        cell_buffer[i].shuffle = i;
-    }
-    for (i = length - 1; i >= 0; i--) {
-        // int roll = i == 0 ? 0 : rand() % i;
-        // idx = cell_buffer[roll].shuffle;
+        pairmode_cell *cell = &cell_buffer[i];
 
-        // cell_buffer[roll].shuffle = cell_buffer[i].shuffle;
+        pair = cell->drawn_pair;
+        if (pair == 0
+            || prs[pair].fore.idx != cell->fore.idx
+            || prs[pair].back.idx != cell->back.idx) {
 
-        idx = i;
+            pair = coerce_prs(&cell->fore, &cell->back);
+        }
 
-        int pair = coerce_prs(&cell_buffer[idx].fore, &cell_buffer[idx].back);
-        cell_buffer[idx].pair = pair;
-    }
+        if (pair != cell->drawn_pair || cell->ch != cell->drawn_ch) {
+            if (cell->drawn_pair) prs[cell->drawn_pair].count--;
+            prs[pair].count++;
+            cell->drawn_pair = pair;
+            cell->drawn_ch = cell->ch;
 
-    // render it all!
-    i = 0;
-    for (y = 0; y < minsize.height; y++) {
-        move(y, 0);
-        for (x = 0; x < minsize.width; x++) {
-            color_set(cell_buffer[i].pair, NULL);
-            addch(cell_buffer[i].ch);
-            i++;
+            color_set(pair, NULL);
+            mvaddch(i / minsize.width, i % minsize.width, cell->ch);
         }
     }
 }
@@ -526,7 +581,7 @@ static void term_mvaddch(int x, int y, int ch, fcolor *fg, fcolor *bg) {
     if (x < 0 || y < 0 || x >= minsize.width || y >= minsize.height) return;
 
     if (colormode == coerce_16) {
-        int c = best(fg, bg);
+        int c = cached_best(fg, bg);
         attrset(COLOR_ATTR(c));
         mvaddch(y, x, ch);
     } else {
@@ -646,10 +701,15 @@ static void ensure_size( ) {
         nodelay(stdscr, TRUE);
         erase();
         refresh();
+        forget_drawn_cells();
     }
 }
 
 static void term_resize(int w, int h) {
+    // the old cell buffer doesn't fit the new size
+    if (cell_buffer) free(cell_buffer);
+    cell_buffer = 0;
+
     minsize.width = w;
     minsize.height = h;
 
@@ -661,19 +721,12 @@ static void term_resize(int w, int h) {
     ensure_size();
 
 
-    // make a new cell buffer
-
-    if (cell_buffer) free(cell_buffer);
-    cell_buffer = malloc(sizeof(pairmode_cell) * w * h);
+    // make a new cell buffer, with nothing drawn yet
+    cell_buffer = calloc(w * h, sizeof(pairmode_cell));
     // add error checking
-    int i;
 
-    for (i = 0; i < w * h; i++) {
-        // I guess we could just zero it all, hmm
-        cell_buffer[i].ch = 0;
-        cell_buffer[i].pair = 0;
-        cell_buffer[i].fore.idx = 0;
-        cell_buffer[i].back.idx = 0;
+    if (colormode == coerce_256) {
+        forget_drawn_cells();
     }
 }
 